@@ -29,6 +29,7 @@ void action_move(void *data, int num, client *cli)
 	if (!cli) return;
 	client_raise_family(cli);
 	client_place_spot(cli, num, cli->monitor, 1);
+	places_remember(cli);
 }
 
 void action_move_direction(void *data, int num, client *cli)
@@ -36,6 +37,7 @@ void action_move_direction(void *data, int num, client *cli)
 	if (!cli) return;
 	client_raise_family(cli);
 	client_place_spot(cli, spot_choose_by_direction(cli->spot, cli->monitor, num), cli->monitor, 1);
+	places_remember(cli);
 }
 
 void action_focus(void *data, int num, client *cli)
@@ -54,14 +56,37 @@ void action_close(void *data, int num, client *cli)
 		XKillClient(display, cli->window);
 }
 
+// num > 1 cycles that many windows in one restack, as for repeated presses
 void action_cycle(void *data, int num, client *cli)
 {
 	if (!cli) return;
-	STACK_INIT(lower);
-	spot_focus_top_window(cli->spot, cli->monitor, cli->window);
-	client_stack_family(cli, &lower);
-	XLowerWindow(display, lower.windows[0]);
-	XRestackWindows(display, lower.windows, lower.depth);
+	if (num <= 1)
+	{
+		spot_focus_top_window(cli->spot, cli->monitor, cli->window);
+		client_lower_family(cli);
+		return;
+	}
+	int i, n = 0; client *c, *ring[STACK]; STACK_INIT(order);
+	for_windows(i, c) if (c->manage && c->visible && !c->transient && c->spot == cli->spot && c->monitor == cli->monitor)
+		ring[n++] = c;
+	if (!n || !(num %= n)) return;
+
+	// the order num single cycles would leave: ring[num] on top and the
+	// windows cycled past at the bottom. docks stay above, as on any raise
+	for_windows(i, c) if (c->type == atoms[_NET_WM_WINDOW_TYPE_DOCK])
+		client_stack_family(c, &order);
+	for (i = 0; i < n; i++)
+	{
+		client_stack_family(ring[(num+i) % n], &order);
+		if (!i && !ring[num]->full && TITLE)
+		{
+			order.windows[order.depth] = monitors[cli->monitor].bars[cli->spot]->window;
+			order.clients[order.depth++] = NULL;
+		}
+	}
+	XRaiseWindow(display, order.windows[0]);
+	XRestackWindows(display, order.windows, order.depth);
+	client_set_focus(ring[num]);
 }
 
 void action_raise_nth(void *data, int num, client *cli)
@@ -74,7 +99,7 @@ void action_raise_nth(void *data, int num, client *cli)
 
 void action_command(void *data, int num, client *cli)
 {
-	exec_cmd(data);
+	launch(data);
 }
 
 void action_find_or_start(void *data, int num, client *cli)
@@ -83,7 +108,22 @@ void action_find_or_start(void *data, int num, client *cli)
 	for_windows(i, c)
 		if (c->visible && c->manage && c->class && !strcasecmp(c->class, class))
 			{ client_activate(c); return; }
-	exec_cmd(class);
+	launch(class);
+}
+
+void action_focus_previous(void *data, int num, client *cli)
+{
+	client_activate_previous(-1);
+}
+
+void action_switcher(void *data, int num, client *cli)
+{
+	switcher_open();
+}
+
+void action_run(void *data, int num, client *cli)
+{
+	run_open();
 }
 
 void action_move_monitor(void *data, int num, client *cli)
@@ -92,12 +132,16 @@ void action_move_monitor(void *data, int num, client *cli)
 	client_raise_family(cli);
 	cli->monitor = MAX(0, MIN(current_mon+num, nmonitors-1));
 	client_place_spot(cli, cli->spot, cli->monitor, 1);
+	places_remember(cli);
 	current_mon = cli->monitor;
 }
 
 void action_focus_monitor(void *data, int num, client *cli)
 {
-	int i, mon = MAX(0, MIN(current_mon+num, nmonitors-1));
+	int i, mon = MAX(0, MIN(current_mon+num, nmonitors-1)); client *c;
+	// back to whatever was last used there
+	if (monitor_focus[mon] && (c = focus_candidate(monitor_focus[mon], mon)))
+		{ client_activate(c); return; }
 	if (spot_focus_top_window(current_spot, mon, None)) return;
 	for_spots(i) if (spot_focus_top_window(i, mon, None)) break;
 }
@@ -118,6 +162,7 @@ void action_maximize_vert(void *data, int num, client *cli)
 	if (!cli) return;
 	cli->maxv = client_toggle_state(cli, atoms[_NET_WM_STATE_MAXIMIZE_VERT]);
 	client_place_spot(cli, cli->spot, cli->monitor, 1);
+	places_remember(cli);
 }
 
 void action_maximize_horz(void *data, int num, client *cli)
@@ -125,4 +170,5 @@ void action_maximize_horz(void *data, int num, client *cli)
 	if (!cli) return;
 	cli->maxh = client_toggle_state(cli, atoms[_NET_WM_STATE_MAXIMIZE_HORZ]);
 	client_place_spot(cli, cli->spot, cli->monitor, 1);
+	places_remember(cli);
 }
\ No newline at end of file
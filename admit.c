@@ -0,0 +1,91 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Admission of a new window, all from its MapRequest: place, map, raise
+// and focus in one ordered batch of requests, with the EWMH and bar updates
+// deferred as usual. map_notify then has nothing left to do for it.
+
+struct {
+	unsigned long windows;
+	long long usec, max;
+} admissions;
+
+void admit(client *c)
+{
+	TRACE("call", "admit");
+	long long start = usec();
+
+	c->monitor = current_mon;
+	monitor *m = &monitors[c->monitor];
+
+	int i, maxv, maxh, spot = SPOT_START == SPOT_CURRENT ? current_spot: SPOT_START;
+
+	if (places_recall(c, &spot, &i, &maxv, &maxh)) // same place as last time
+	{
+		c->monitor = i;
+		if (maxv != c->maxv || maxh != c->maxh)
+		{
+			if (!c->prefetched && !GETPROP_ATOM(c->window, atoms[_NET_WM_STATE], c->states, ATOMLIST))
+				memset(c->states, 0, sizeof(Atom) * ATOMLIST);
+			if (maxv != client_has_state(c, atoms[_NET_WM_STATE_MAXIMIZE_VERT]))
+				client_toggle_state(c, atoms[_NET_WM_STATE_MAXIMIZE_VERT]);
+			if (maxh != client_has_state(c, atoms[_NET_WM_STATE_MAXIMIZE_HORZ]))
+				client_toggle_state(c, atoms[_NET_WM_STATE_MAXIMIZE_HORZ]);
+			c->maxv = maxv; c->maxh = maxh;
+		}
+	}
+	else
+	if (SPOT_START == SPOT_SMART) // find spot of best fit
+	{
+		spot = SPOT1; for_spots_rev(i)
+			if (c->attr.width <= m->spots[i].w && c->attr.height <= m->spots[i].h)
+				{ spot = i; break; }
+	}
+	client_place_spot(c, spot, c->monitor, 0);
+
+	// final border now rather than in the deferred phase, so nothing about
+	// the frame changes once it is visible. it is about to take focus
+	XSetWindowBorder(display, c->window, pixel_focus);
+	XSetWindowBorderWidth(display, c->window, c->full ? 0: settings.border);
+
+	// viewable as soon as the server reads this, so the raise and focus
+	// requests that follow apply to it
+	XMapWindow(display, c->window);
+	c->visible = 1;
+
+	client_raise_family(c);
+	client_set_focus(c);
+
+	cache_get(c->window)->admitted = 1;
+	ewmh_client_add(c->window);
+	defer(DEFER_CLIENT_LIST);
+	defer_bars();
+
+	long long took = usec() - start;
+	admissions.windows++;
+	admissions.usec += took;
+	admissions.max = MAX(admissions.max, took);
+}
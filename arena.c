@@ -0,0 +1,153 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Per-event memory. Client records, property strings and other transient
+// data are bumped out of a fixed block that the main loop resets after every
+// event. Anything that doesn't fit falls back to calloc and is freed on
+// reset. Titles live in fixed cache slots and text buffers are reused, so
+// xoat's own event path stays off the heap; Xlib still allocates for each
+// property it returns. `xoat stats` counts every malloc and free in the
+// process, Xlib's and Xft's included, to show what is left.
+
+#define ARENA (64*1024)
+#define ARENA_ALIGN 16
+#define INTERN 256
+
+typedef union arena_chunk {
+	union arena_chunk *next;
+	char align[ARENA_ALIGN];
+} arena_chunk;
+
+union {
+	char bytes[ARENA];
+	long double align;
+} arena_mem;
+
+size_t arena_used;
+void *arena_last;
+arena_chunk *arena_overflow;
+
+struct {
+	unsigned long allocs, overflows, interned;
+	size_t high;
+} arena_stats;
+
+// zeroed memory that lives until arena_reset()
+void* arena_alloc(size_t size)
+{
+	size = (size + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+	arena_stats.allocs++;
+	if (arena_used + size <= ARENA)
+	{
+		void *p = arena_last = arena_mem.bytes + arena_used;
+		arena_used += size;
+		arena_stats.high = MAX(arena_stats.high, arena_used);
+		return memset(p, 0, size);
+	}
+	arena_stats.overflows++;
+	arena_chunk *chunk = calloc(1, sizeof(arena_chunk) + size);
+	if (!chunk) errx(EXIT_FAILURE, "out of memory");
+	chunk->next = arena_overflow;
+	arena_overflow = chunk;
+	return chunk+1;
+}
+
+// give back the most recent allocation early, eg a client that query_windows
+// decided not to keep. anything else waits for the reset
+void arena_release(void *p)
+{
+	if (!p || p != arena_last) return;
+	arena_used = (char*)p - arena_mem.bytes;
+	arena_last = NULL;
+}
+
+void arena_reset()
+{
+	arena_chunk *chunk;
+	while ((chunk = arena_overflow))
+	{
+		arena_overflow = chunk->next;
+		free(chunk);
+	}
+	arena_used = 0;
+	arena_last = NULL;
+}
+
+// WM_CLASS strings repeat endlessly; keep one copy of each for good
+char *interned[INTERN];
+
+char* intern(const char *str)
+{
+	unsigned long h = 5381; const char *s; int i, slot;
+	for (s = str; *s; s++) h = h * 33 + *s;
+	for (i = 0; i < INTERN; i++)
+	{
+		slot = (h + i) % INTERN;
+		if (!interned[slot])
+		{
+			arena_stats.interned++;
+			return interned[slot] = strdup(str);
+		}
+		if (!strcmp(interned[slot], str))
+			return interned[slot];
+	}
+	return strcpy(arena_alloc(strlen(str)+1), str);
+}
+
+#ifdef __GLIBC__
+// glibc lets a program replace the allocator; pass everything through to
+// it, counting as we go. the render thread allocates too
+void *__libc_malloc(size_t), *__libc_calloc(size_t, size_t), *__libc_realloc(void*, size_t);
+void __libc_free(void*);
+
+struct {
+	unsigned long allocs, frees;
+} heap_stats;
+
+void* malloc(size_t size)
+{
+	__atomic_add_fetch(&heap_stats.allocs, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+	__atomic_add_fetch(&heap_stats.allocs, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(n, size);
+}
+
+void* realloc(void *p, size_t size)
+{
+	__atomic_add_fetch(&heap_stats.allocs, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+	if (p) __atomic_add_fetch(&heap_stats.frees, 1, __ATOMIC_RELAXED);
+	__libc_free(p);
+}
+#endif
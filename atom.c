@@ -31,6 +31,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	X(XOAT_SPOT),\
 	X(XOAT_EXIT),\
 	X(XOAT_RESTART),\
+	X(XOAT_STATS),\
 	X(_NET_SUPPORTED),\
 	X(_NET_ACTIVE_WINDOW),\
 	X(_NET_CLOSE_WINDOW),\
@@ -53,6 +54,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	X(_NET_WM_STATE_MAXIMIZE_HORZ),\
 	X(_NET_WM_STATE_DEMANDS_ATTENTION),\
 	X(WM_NAME),\
+	X(WM_WINDOW_ROLE),\
 	X(WM_DELETE_WINDOW),\
 	X(WM_CLIENT_LEADER),\
 	X(WM_TAKE_FOCUS),\
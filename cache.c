@@ -0,0 +1,160 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Per-window state that outlives a single event. Client structs are rebuilt
+// from the server for every event; anything expensive to fetch and rarely
+// changed lives here instead, keyed by window id.
+
+#define CACHE 128
+#define CACHE_TITLE 256
+
+typedef struct {
+	Window window;
+	char title[CACHE_TITLE], class[32], role[32];
+	Atom protocols[ATOMLIST];
+	short titled, untitled, protocolled, nprotocols, admitted, classed;
+	int title_timer;
+	long long title_shown;
+	unsigned long title_updates, title_throttled;
+} cached;
+
+cached cache[CACHE];
+int cache_next;
+
+cached* cache_find(Window w)
+{
+	for (int i = 0; w != None && i < CACHE; i++)
+		if (cache[i].window == w) return &cache[i];
+	return NULL;
+}
+
+void cache_forget(Window w)
+{
+	cached *e = cache_find(w);
+	if (!e) return;
+	timer_cancel(e->title_timer);
+	memset(e, 0, sizeof(cached));
+}
+
+// find or create. when full, recycle slots round-robin
+cached* cache_get(Window w)
+{
+	int i; cached *e = cache_find(w);
+	if (e) return e;
+	for (i = 0; i < CACHE && cache[i].window; i++);
+	if (i == CACHE)
+	{
+		i = cache_next++ % CACHE;
+		cache_forget(cache[i].window);
+	}
+	cache[i].window = w;
+	return &cache[i];
+}
+
+// decoded _NET_WM_NAME, falling back to WM_NAME, in the per-event arena
+char* window_title(Window w)
+{
+	char *name = NULL, *tmp = NULL;
+	if (!(name = window_get_text_prop(w, atoms[_NET_WM_NAME])))
+	{
+		TRACE_SYNC("XFetchName");
+		if (XFetchName(display, w, &tmp) && tmp)
+			name = strcpy(arena_alloc(strlen(tmp)+1), tmp);
+	}
+	if (tmp) XFree(tmp);
+	return name;
+}
+
+// fetched once, then again only after property_notify() sees a change.
+// longer titles than a bar could show are cut on a character boundary
+char* cache_title(Window w)
+{
+	cached *e = cache_get(w); char *name; int len;
+	if (!e->titled)
+	{
+		name = window_title(w);
+		len  = name ? strlen(name): 0;
+		if (len >= CACHE_TITLE)
+			for (len = CACHE_TITLE-1; len > 0 && UTF8_CONT(name[len]); len--);
+		memmove(e->title, name ? name: "", len);
+		e->title[len] = 0;
+		e->untitled = !name;
+		e->titled   = 1;
+	}
+	return e->untitled ? NULL: e->title;
+}
+
+// WM_PROTOCOLS, read once per window
+int cache_has_protocol(Window w, Atom protocol)
+{
+	cached *e = cache_get(w);
+	if (!e->protocolled)
+	{
+		e->nprotocols  = GETPROP_ATOM(w, atoms[WM_PROTOCOLS], e->protocols, ATOMLIST);
+		e->protocolled = 1;
+	}
+	for (int i = 0; i < e->nprotocols; i++)
+		if (e->protocols[i] == protocol) return 1;
+	return 0;
+}
+
+// WM_CLASS res_class and WM_WINDOW_ROLE, read once per window
+void cache_class(Window w, char *class, char *role)
+{
+	XClassHint chint; char *tmp; cached *e = cache_get(w);
+	if (!e->classed)
+	{
+		*e->class = 0;
+		TRACE_SYNC("XGetClassHint");
+		if (XGetClassHint(display, w, &chint))
+		{
+			snprintf(e->class, sizeof(e->class), "%s", chint.res_class);
+			XFree(chint.res_class); XFree(chint.res_name);
+		}
+		tmp = window_get_text_prop(w, atoms[WM_WINDOW_ROLE]);
+		snprintf(e->role, sizeof(e->role), "%s", tmp ? tmp: "");
+		e->classed = 1;
+	}
+	snprintf(class, 32, "%s", e->class);
+	snprintf(role,  32, "%s", e->role);
+}
+
+// a property changed; drop whatever depended on it. returns 1 for titles
+int cache_property(Window w, Atom atom)
+{
+	cached *e = cache_find(w);
+	int title = atom == atoms[WM_NAME] || atom == atoms[_NET_WM_NAME];
+	if (!e) return title;
+	if (title)
+	{
+		e->titled = 0;
+	}
+	if (atom == atoms[WM_PROTOCOLS])
+		e->protocolled = 0;
+	if (atom == XA_WM_CLASS || atom == atoms[WM_WINDOW_ROLE])
+		e->classed = 0;
+	return title;
+}
@@ -54,10 +54,12 @@ client* window_build_client(Window win)
 {
 	int i, j; XClassHint chint; XWMHints *hints; monitor *m;
 	if (win == None) return NULL;
+	TRACE("call", "window_build_client");
 
-	client *c = calloc(1, sizeof(client));
+	client *c = arena_alloc(sizeof(client));
 	c->window = win;
 
+	TRACE_SYNC("XGetWindowAttributes");
 	if (XGetWindowAttributes(display, c->window, &c->attr))
 	{
 		c->visible = c->attr.map_state == IsViewable ? 1:0;
@@ -78,6 +80,7 @@ client* window_build_client(Window win)
 
 		if (c->manage)
 		{
+			TRACE_SYNC("XGetTransientForHint");
 			XGetTransientForHint(display, c->window, &c->transient);
 			if (!GETPROP_WIND(win, atoms[WM_CLIENT_LEADER], &c->leader, 1)) c->leader = None;
 			c->spot = SPOT1; m = &monitors[0];
@@ -112,52 +115,106 @@ client* window_build_client(Window win)
 						c->attr.x + c->attr.width/10, c->attr.y + c->attr.height/10, c->attr.width  - c->attr.width/10, c->attr.height - c->attr.height/10))
 							c->spot = SPOT3;
 
+				TRACE_SYNC("XGetWMHints");
 				if ((hints = XGetWMHints(display, c->window)))
 				{
 					c->input  = hints->flags & InputHint && hints->input ? 1:0;
 					c->urgent = c->urgent || hints->flags & XUrgencyHint ? 1:0;
 					XFree(hints);
 				}
+				TRACE_SYNC("XGetClassHint");
 				if (XGetClassHint(display, c->window, &chint))
 				{
-					c->class = strdup(chint.res_class);
+					c->class = intern(chint.res_class);
 					XFree(chint.res_class); XFree(chint.res_name);
 				}
 			}
 		}
 		return c;
 	}
-	free(c);
+	client_free(c);
 	return NULL;
 }
 
+// clients live in the per-event arena; class strings are interned
 void client_free(client *c)
 {
-	if (!c) return;
-	free(c->class);
-	free(c);
+	arena_release(c);
 }
 
-void client_update_border(client *c)
+// border colors are allocated once in setup()
+unsigned long color_pixel(char *name)
 {
 	XColor color; Colormap map = DefaultColormap(display, DefaultScreen(display));
-	char *colorname = c->window == current ? BORDER_FOCUS: (c->urgent ? BORDER_URGENT: BORDER_BLUR);
-	XSetWindowBorder(display, c->window, XAllocNamedColor(display, map, colorname, &color, &color) ? color.pixel: None);
-	XSetWindowBorderWidth(display, c->window, c->full ? 0: BORDER);
+	return XAllocNamedColor(display, map, name, &color, &color) ? color.pixel: None;
+}
+
+// the focused client, and the one before it. kept so focus changes
+// don't have to rebuild the old window from the server
+client focus_cur, focus_prev;
+Window active_window = None;
+
+// most recently focused first, plus the last focused window per monitor
+#define FOCUS_HISTORY 32
+Window focus_history[FOCUS_HISTORY], monitor_focus[MONITORS];
+int nfocus_history;
+
+void focus_forget(Window w)
+{
+	int i, j;
+	for (i = 0, j = 0; i < nfocus_history; i++)
+		if (focus_history[i] != w) focus_history[j++] = focus_history[i];
+	nfocus_history = j;
+	for (i = 0; i < MONITORS; i++)
+		if (monitor_focus[i] == w) monitor_focus[i] = None;
+}
+
+void focus_remember(client *c)
+{
+	focus_forget(c->window);
+	memmove(&focus_history[1], &focus_history[0], sizeof(Window) * MIN(nfocus_history, FOCUS_HISTORY-1));
+	focus_history[0] = c->window;
+	nfocus_history = MIN(nfocus_history+1, FOCUS_HISTORY);
+	monitor_focus[c->monitor] = c->window;
+}
+
+// still a focusable managed window? mon < 0 for any monitor
+client* focus_candidate(Window w, int mon)
+{
+	client *c = window_build_client(w);
+	if (c && c->visible && c->manage && (mon < 0 || c->monitor == mon))
+		return c;
+	client_free(c);
+	return NULL;
+}
+
+void client_paint_border(Window w, int urgent, int full)
+{
+	XSetWindowBorder(display, w, w == current ? pixel_focus: (urgent ? pixel_urgent: pixel_blur));
+	XSetWindowBorderWidth(display, w, full ? 0: settings.border);
+}
+
+// painted in the deferred phase, once per window
+void client_update_border(client *c)
+{
+	if (c->window == focus_cur.window)
+	{
+		focus_cur.urgent = c->urgent;
+		focus_cur.full   = c->full;
+	}
+	defer_border(c->window, c->urgent, c->full);
 }
 
 int client_send_wm_protocol(client *c, Atom protocol)
 {
-	Atom protocols[ATOMLIST]; int i, n;
-	if ((n = GETPROP_ATOM(c->window, atoms[WM_PROTOCOLS], protocols, ATOMLIST)))
-		for (i = 0; i < n; i++) if (protocols[i] == protocol)
-			return window_send_clientmessage(c->window, c->window, atoms[WM_PROTOCOLS], protocol, NoEventMask);
-	return 0;
+	return cache_has_protocol(c->window, protocol)
+		&& window_send_clientmessage(c->window, c->window, atoms[WM_PROTOCOLS], protocol, NoEventMask);
 }
 
 void client_place_spot(client *c, int spot, int mon, int force)
 {
 	if (!c) return;
+	TRACE("call", "client_place_spot");
 	int i; client *t;
 
 	// try to center over our transient parent
@@ -187,8 +244,8 @@ void client_place_spot(client *c, int spot, int mon, int force)
 	{
 		x += (w - c->attr.width)/2;
 		y += (h - c->attr.height)/2;
-		w = c->attr.width + BORDER*2;
-		h = c->attr.height + BORDER*2;
+		w = c->attr.width + settings.border*2;
+		h = c->attr.height + settings.border*2;
 	}
 	else
 	if (c->full)
@@ -209,10 +266,12 @@ void client_place_spot(client *c, int spot, int mon, int force)
 		w = m->w;
 	}
 
-	w -= BORDER*2; h -= BORDER*2;
+	w -= settings.border*2; h -= settings.border*2;
 	int sw = w, sh = h; long sr; XSizeHints size;
 
-	if (XGetWMNormalHints(display, c->window, &size, &sr))
+	if (c->size) size = *c->size;
+	else TRACE_SYNC("XGetWMNormalHints");
+	if (c->size || XGetWMNormalHints(display, c->window, &size, &sr))
 	{
 		w = MIN(MAX(w, size.flags & PMinSize ? size.min_width : 16), size.flags & PMaxSize ? size.max_width : m->w);
 		h = MIN(MAX(h, size.flags & PMinSize ? size.min_height: 16), size.flags & PMaxSize ? size.max_height: m->h);
@@ -236,8 +295,8 @@ void client_place_spot(client *c, int spot, int mon, int force)
 	if (h < sh) y += (sh-h)/2;
 
 	// bump onto screen
-	x = MAX(m->x, MIN(x, m->x + m->w - w - BORDER*2));
-	y = MAX(m->y, MIN(y, m->y + m->h - h - BORDER*2));
+	x = MAX(m->x, MIN(x, m->x + m->w - w - settings.border*2));
+	y = MAX(m->y, MIN(y, m->y + m->h - h - settings.border*2));
 
 	XMoveResizeWindow(display, c->window, x, y, w, h);
 }
@@ -263,7 +322,8 @@ void client_stack_family(client *c, stack *raise)
 void client_raise_family(client *c)
 {
 	if (!c) return;
-	int i; client *o; STACK_INIT(raise); STACK_INIT(family);
+	TRACE("call", "client_raise_family");
+	int i; client *o, *self = c; STACK_INIT(raise); STACK_INIT(family);
 
 	for_windows(i, o) if (o->type == atoms[_NET_WM_WINDOW_TYPE_DOCK])
 		client_stack_family(o, &raise);
@@ -273,6 +333,14 @@ void client_raise_family(client *c)
 
 	client_stack_family(c, &raise);
 
+	// a window admitted in this same event is not in the query yet
+	for (i = 0; i < raise.depth && raise.windows[i] != self->window; i++);
+	if (self->visible && i == raise.depth)
+	{
+		raise.clients[raise.depth] = self;
+		raise.windows[raise.depth++] = self->window;
+	}
+
 	if (!c->full && TITLE)
 	{
 		// raise spot's title bar in case some other fullscreen or max v/h window has obscured
@@ -288,23 +356,58 @@ void client_raise_family(client *c)
 	STACK_FREE(&family);
 }
 
+void client_lower_family(client *c)
+{
+	STACK_INIT(lower);
+	client_stack_family(c, &lower);
+	if (!lower.depth) return;
+	XLowerWindow(display, lower.windows[0]);
+	XRestackWindows(display, lower.windows, lower.depth);
+}
+
+// the focused window has no button grab, so clicks and drags inside it
+// never wait on us. move the one ungrabbed window along with focus
+Window buttons_free;
+
+void client_free_buttons(Window w)
+{
+	if (w == buttons_free) return;
+	if (buttons_free) window_grab_buttons(buttons_free);
+	if (w)
+	{
+		XUngrabButton(display, Button1, AnyModifier, w);
+		XUngrabButton(display, Button3, AnyModifier, w);
+	}
+	buttons_free = w;
+}
+
 void client_set_focus(client *c)
 {
 	if (!c || !c->visible || c->window == current) return;
-	client *o; Window old = current;
+	Window old = current;
 
 	current      = c->window;
 	current_spot = c->spot;
 	current_mon  = c->monitor;
 
-	if (old && (o = window_build_client(old)))
+	// repaint the old border from its record
+	if (old && focus_cur.window == old)
 	{
-		client_update_border(o);
-		client_free(o);
+		focus_prev = focus_cur;
+		client_update_border(&focus_prev);
 	}
+	focus_cur = *c;
+	focus_cur.class = NULL;
+	focus_remember(c);
+
+	client_free_buttons(c->window);
 	client_send_wm_protocol(c, atoms[WM_TAKE_FOCUS]);
-	XSetInputFocus(display, c->input ? c->window: PointerRoot, RevertToPointerRoot, CurrentTime);
-	SETPROP_WIND(root, atoms[_NET_ACTIVE_WINDOW], &c->window, 1);
+	XSetInputFocus(display, c->input ? c->window: PointerRoot, RevertToPointerRoot, latest);
+	if (active_window != c->window)
+	{
+		active_window = c->window;
+		SETPROP_WIND(root, atoms[_NET_ACTIVE_WINDOW], &c->window, 1);
+	}
 	client_update_border(c);
 }
 
@@ -313,3 +416,21 @@ void client_activate(client *c)
 	client_raise_family(c);
 	client_set_focus(c);
 }
+
+// most recently used window other than the current one. mon < 0 for any.
+// finding it costs one window build per candidate, but activating it still
+// queries the tree, as raising needs its transients and the docks
+int client_activate_previous(int mon)
+{
+	client *c;
+	for (int i = 0; i < nfocus_history; i++)
+	{
+		if (focus_history[i] == current) continue;
+		if ((c = focus_candidate(focus_history[i], mon)))
+		{
+			client_activate(c);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -15,7 +15,16 @@
 // Title bar style
 #define TITLE_BLUR "Black"
 #define TITLE_FOCUS "White"
-#define TITLE_ELLIPSIS 32
+// Minimum milliseconds between title bar refreshes caused by one window
+// changing its title. The latest title is always shown at the end of a burst.
+#define TITLE_INTERVAL 250
+
+// Titles wider than this many pixels are cut short with "...". 0 = no limit.
+#define TITLE_ELLIPSIS 200
+
+// Draw title bars on a separate thread and display connection, so slow
+// font rendering never holds up key or focus handling. 0 = draw inline.
+#define TITLE_THREAD 1
 
 // There are three static tiles called SPOT1, SPOT2, and SPOT3.
 // Want more tiles? Different layouts? Floating? Go away ;)
@@ -55,6 +64,28 @@
 // If spot is not current, window won't steal focus.
 //#define SPOT_START SPOT1
 
+// Switcher and launcher overlay style.
+#define MENU_FONT "sans:size=10"
+#define MENU_FG "White"
+#define MENU_BG "Black"
+#define MENU_HLFG "White"
+#define MENU_HLBG "Royal Blue"
+
+// Remember the last spot, monitor and max v/h used by each WM_CLASS and
+// WM_WINDOW_ROLE, and put new windows there. Path is relative to $HOME.
+// Setting this to NULL will disable placement memory.
+//#define PLACES_FILE NULL
+#define PLACES_FILE ".xoat_places"
+
+// Runtime settings and extra key bindings, relative to $HOME. The file can
+// override BORDER, GAP, the colors, TITLE, the spot percentages and add
+// "bind" lines; it is reloaded on SIGHUP or when saved. NULL to disable.
+//#define CONFIG_FILE NULL
+#define CONFIG_FILE ".xoatrc"
+
+// Print a breakdown of startup time by phase to stderr.
+#define STARTUP_REPORT 0
+
 // Available actions...
 // action_move             .num = SPOT1/2/3
 // action_focus            .num = SPOT1/2/3
@@ -66,6 +97,9 @@
 // action_find_or_start
 // action_move_monitor
 // action_focus_monitor
+// action_focus_previous
+// action_switcher
+// action_run
 // action_fullscreen
 // action_maximize_vert
 // action_maximize_horz
@@ -110,6 +144,12 @@ binding keys[] = {
 	{ .mod = Mod4Mask, .key = XK_v, .act = action_maximize_vert },
 	{ .mod = Mod4Mask, .key = XK_h, .act = action_maximize_horz },
 
+	// Focus the previously used window, anywhere.
+	{ .mod = Mod4Mask, .key = XK_BackSpace, .act = action_focus_previous },
+
+	// Pick a window by class or title.
+	{ .mod = Mod4Mask, .key = XK_s, .act = action_switcher },
+
 	// Switch focus between monitors.
 	{ .mod = Mod4Mask, .key = XK_Next,  .act = action_focus_monitor, .num = +1 },
 	{ .mod = Mod4Mask, .key = XK_Prior, .act = action_focus_monitor, .num = -1 },
@@ -119,7 +159,7 @@ binding keys[] = {
 	{ .mod = ShiftMask|Mod4Mask, .key = XK_Prior, .act = action_move_monitor, .num = -1 },
 
 	// Launcher
-	{ .mod = Mod4Mask, .key = XK_x,  .act = action_command, .data = "dmenu_run" },
+	{ .mod = Mod4Mask, .key = XK_x,  .act = action_run },
 	{ .mod = Mod4Mask, .key = XK_F1, .act = action_command, .data = "konsole"   },
 	{ .mod = Mod4Mask, .key = XK_F2, .act = action_command, .data = "chromium"  },
 	{ .mod = Mod4Mask, .key = XK_F3, .act = action_command, .data = "pcmanfm"   },
@@ -0,0 +1,96 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Handlers mark what needs doing and the main loop does it once, after the
+// event queue drains and before it sleeps. One map cycle then produces one
+// border update per window, one client list check and one pass over bars.
+
+#define DEFER_CLIENT_LIST (1<<0)
+
+struct {
+	unsigned int flags;
+	unsigned long bars;
+	int nborders;
+	struct {
+		Window window;
+		short urgent, full;
+	} borders[STACK];
+} deferred;
+
+void client_paint_border(Window w, int urgent, int full);
+
+void defer(unsigned int flags)
+{
+	deferred.flags |= flags;
+}
+
+void defer_bar(int spot, int mon)
+{
+	deferred.bars |= 1UL << (mon * (SPOT3+1) + spot);
+}
+
+void defer_bars()
+{
+	deferred.bars = ~0UL;
+}
+
+void defer_border(Window w, int urgent, int full)
+{
+	int i;
+	for (i = 0; i < deferred.nborders && deferred.borders[i].window != w; i++);
+	if (i == STACK)
+	{
+		client_paint_border(w, urgent, full);
+		return;
+	}
+	deferred.borders[i].window = w;
+	deferred.borders[i].urgent = urgent;
+	deferred.borders[i].full   = full;
+	deferred.nborders = MAX(deferred.nborders, i+1);
+}
+
+// returns 1 if anything was done
+int defer_flush()
+{
+	int i, j, done = deferred.flags || deferred.bars || deferred.nborders; monitor *m;
+	if (!done) return 0;
+	TRACE("loop", "defer_flush");
+
+	for (i = 0; i < deferred.nborders; i++)
+		client_paint_border(deferred.borders[i].window, deferred.borders[i].urgent, deferred.borders[i].full);
+	deferred.nborders = 0;
+
+	if (deferred.flags & DEFER_CLIENT_LIST)
+		ewmh_client_list();
+
+	if (TITLE && deferred.bars) for_monitors(i, m) for_spots(j)
+		if (deferred.bars & (1UL << (i * (SPOT3+1) + j)))
+			spot_update_bar(j, i);
+
+	deferred.flags = 0;
+	deferred.bars  = 0;
+	return done;
+}
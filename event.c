@@ -28,7 +28,11 @@ void create_notify(XEvent *e)
 {
 	client *c = window_build_client(e->xcreatewindow.window);
 	if (c && c->manage)
+	{
+		// listen first so nothing set after the prefetch goes unseen
 		window_listen(c->window);
+		prefetch_store(c);
+	}
 	client_free(c);
 }
 
@@ -50,7 +54,7 @@ void configure_request(XEvent *ev)
 		if (e->value_mask & CWWidth)  wc.width  = e->width;
 		if (e->value_mask & CWHeight) wc.height = e->height;
 		if (e->value_mask & CWStackMode)   wc.stack_mode   = e->detail;
-		if (e->value_mask & CWBorderWidth) wc.border_width = BORDER;
+		if (e->value_mask & CWBorderWidth) wc.border_width = settings.border;
 		XConfigureWindow(display, c->window, e->value_mask, &wc);
 	}
 	client_free(c);
@@ -58,41 +62,39 @@ void configure_request(XEvent *ev)
 
 void configure_notify(XEvent *e)
 {
+	prefetch_configure(&e->xconfigure);
 	client *c = window_build_client(e->xconfigure.window);
 	if (c && c->manage)
 	{
 		while (XCheckTypedEvent(display, ConfigureNotify, e));
-		ewmh_client_list();
-		update_bars();
+		defer(DEFER_CLIENT_LIST);
+		defer_bars();
 	}
 	client_free(c);
 }
 
 void map_request(XEvent *e)
 {
-	client *c = window_build_client(e->xmaprequest.window);
+	// redirected, so no longer override-redirect whatever it was created as
+	unmanaged_remove(e->xmaprequest.window);
+	client *c = prefetch_take(e->xmaprequest.window);
+	if (!c) c = window_build_client(e->xmaprequest.window);
 	if (c && c->manage)
-	{
-		c->monitor = current_mon;
-		monitor *m = &monitors[c->monitor];
-
-		int i, spot = SPOT_START == SPOT_CURRENT ? current_spot: SPOT_START;
-
-		if (SPOT_START == SPOT_SMART) // find spot of best fit
-		{
-			spot = SPOT1; for_spots_rev(i)
-				if (c->attr.width <= m->spots[i].w && c->attr.height <= m->spots[i].h)
-					{ spot = i; break; }
-		}
-		client_place_spot(c, spot, c->monitor, 0);
-		client_update_border(c);
-	}
+		admit(c);
+	else
 	if (c) XMapWindow(display, c->window);
 	client_free(c);
 }
 
 void map_notify(XEvent *e)
 {
+	// already raised and focused by admit()
+	cached *k = cache_find(e->xmap.window);
+	if (k && k->admitted)
+	{
+		k->admitted = 0;
+		return;
+	}
 	client *a = NULL, *c = window_build_client(e->xmap.window);
 	if (c && c->manage)
 	{
@@ -100,56 +102,151 @@ void map_notify(XEvent *e)
 		client_update_border(c);
 		client_set_focus(c);
 		client_free(a);
-		ewmh_client_list();
-		update_bars();
+		ewmh_client_add(c->window);
+		defer(DEFER_CLIENT_LIST);
+		defer_bars();
 	}
 	client_free(c);
 }
 
 void unmap_notify(XEvent *e)
 {
-	// if this window was focused, find something else
-	if (e->xunmap.window == current && !spot_focus_top_window(current_spot, current_mon, current))
+	focus_forget(e->xunmap.window);
+
+	// if this window was focused, go back to what was used before it
+	if (e->xunmap.window == current && !client_activate_previous(current_mon)
+		&& !spot_focus_top_window(current_spot, current_mon, current))
 		{ int i; for_spots(i) if (spot_focus_top_window(i, current_mon, current)) break; }
-	ewmh_client_list();
-	update_bars();
+	ewmh_client_remove(e->xunmap.window);
+	defer(DEFER_CLIENT_LIST);
+	defer_bars();
 }
 
-void key_press(XEvent *ev)
+// how repeated presses of one binding fold into a single step. anything
+// not listed simply runs once per press
+enum { KEY_REPEAT, KEY_ONCE, KEY_PARITY, KEY_COUNT };
+
+#define KEY_RUNS 32
+#define KEY_PRESSES 128
+
+struct {
+	void (*act)(void*, int, client*);
+	int merge;
+} key_merges[] = {
+	{ action_move,           KEY_ONCE   },
+	{ action_focus,          KEY_ONCE   },
+	{ action_close,          KEY_ONCE   },
+	{ action_raise_nth,      KEY_ONCE   },
+	{ action_find_or_start,  KEY_ONCE   },
+	{ action_switcher,       KEY_ONCE   },
+	{ action_run,            KEY_ONCE   },
+	{ action_fullscreen,     KEY_PARITY },
+	{ action_maximize_vert,  KEY_PARITY },
+	{ action_maximize_horz,  KEY_PARITY },
+	{ action_focus_previous, KEY_PARITY },
+	{ action_cycle,          KEY_COUNT  },
+};
+
+int key_merge(void (*act)(void*, int, client*))
+{
+	for (int i = 0; i < sizeof(key_merges)/sizeof(key_merges[0]); i++)
+		if (key_merges[i].act == act) return key_merges[i].merge;
+	return KEY_REPEAT;
+}
+
+binding* key_binding(XKeyEvent *e)
 {
-	XKeyEvent *e = &ev->xkey; latest = e->time;
 	KeySym key = XkbKeycodeToKeysym(display, e->keycode, 0, 0);
 	unsigned int state = e->state & ~(LockMask|NumlockMask);
-	while (XCheckTypedEvent(display, KeyPress, ev));
-
-	binding *bind = NULL;
-	for (int i = 0; i < sizeof(keys)/sizeof(binding) && !bind; i++)
+	for (int i = 0; i < nsettings_keys; i++)
+		if (settings_keys[i].key == key && (settings_keys[i].mod == AnyModifier || settings_keys[i].mod == state))
+			return &settings_keys[i];
+	for (int i = 0; i < sizeof(keys)/sizeof(binding); i++)
 		if (keys[i].key == key && (keys[i].mod == AnyModifier || keys[i].mod == state))
-			bind = &keys[i];
+			return &keys[i];
+	return NULL;
+}
+
+void key_press(XEvent *ev)
+{
+	XKeyEvent *e = &ev->xkey; latest = e->time;
+
+	// the overlay has the keyboard grabbed; every keystroke is its own
+	if (menu.active)
+	{
+		menu_key(ev);
+		return;
+	}
+	binding *runs[KEY_RUNS], *bind; int counts[KEY_RUNS], ends[KEY_RUNS], nruns = 0, i, j, n;
+	XEvent presses[KEY_PRESSES]; int npresses = 0;
 
-	if (bind && bind->act)
+	// group the queued presses into runs of the same binding, in order,
+	// keeping each one in case it has to go back on the queue
+	do {
+		bind = key_binding(&ev->xkey);
+		if (bind && !bind->act) bind = NULL;
+		if (npresses == KEY_PRESSES || (bind && nruns == KEY_RUNS && runs[nruns-1] != bind))
+		{
+			// out of room; leave this press for the next event
+			XPutBackEvent(display, ev);
+			break;
+		}
+		presses[npresses++] = *ev;
+		key_stats.presses++;
+		if (!bind) continue;
+		latest = ev->xkey.time;
+		if (nruns && runs[nruns-1] == bind) counts[nruns-1]++;
+		else { runs[nruns] = bind; counts[nruns++] = 1; }
+		ends[nruns-1] = npresses;
+	} while (XCheckTypedEvent(display, KeyPress, ev));
+
+	for (i = 0; i < nruns; i++)
 	{
-		client *cli = window_build_client(current);
-		bind->act(bind->data, bind->num, cli);
-		client_free(cli);
-		update_bars();
+		bind = runs[i];
+		int merge = key_merge(bind->act), num = bind->num;
+		n = counts[i];
+		if (merge == KEY_ONCE)   n = 1;
+		if (merge == KEY_PARITY) n %= 2;
+		if (merge == KEY_COUNT)  { num = MAX(1, num) * n; n = 1; }
+		key_stats.runs++;
+
+		while (n-- > 0)
+		{
+			TRACE("action", XKeysymToString(bind->key));
+			client *cli = window_build_client(current);
+			bind->act(bind->data, num, cli);
+			client_free(cli);
+			key_stats.actions++;
+		}
+		// an overlay took the keyboard. what followed was typed for it, so
+		// put it back, last first, to arrive in the original order
+		if (menu.active)
+		{
+			for (j = npresses-1; j >= ends[i]; j--)
+				XPutBackEvent(display, &presses[j]);
+			key_stats.presses -= npresses - ends[i];
+			break;
+		}
 	}
+	if (nruns) defer_bars();
 }
 
 void button_press(XEvent *ev)
 {
 	int i, j; monitor *m;
 	XButtonEvent *e = &ev->xbutton; latest = e->time;
-	client *c = window_build_client(e->subwindow);
+
+	// title bars select for clicks; nothing is frozen
+	if (TITLE) for_monitors(i, m) for_spots(j)
+		if (m->bars[j]->window == e->window)
+			{ spot_focus_top_window(j, i, None); return; }
+
+	// otherwise it came through an unfocused window's grab
+	client *c = window_build_client(e->window);
 	if (c && c->manage)
 		client_activate(c);
-	else
-	if (TITLE)
-		for_monitors(i, m) for_spots(j)
-			if (m->bars[j]->window == e->subwindow)
-				spot_focus_top_window(j, i, None);
 	client_free(c);
-	XAllowEvents(display, ReplayPointer, CurrentTime);
+	XAllowEvents(display, ReplayPointer, e->time);
 }
 
 void client_message(XEvent *ev)
@@ -165,6 +262,11 @@ void client_message(XEvent *ev)
 		warnx("restart!");
 		EXECSH(self);
 	}
+	if (e->message_type == atoms[XOAT_STATS])
+	{
+		stats_publish();
+		return;
+	}
 	client *c = window_build_client(e->window);
 	if (c && c->manage)
 	{
@@ -174,27 +276,172 @@ void client_message(XEvent *ev)
 	client_free(c);
 }
 
+// a throttled title's interval is up; show whatever it is now
+void title_refresh(void *data)
+{
+	int i; client *c; Window w = (Window)(uintptr_t)data;
+	cached *e = cache_find(w);
+	if (!e) return;
+	e->title_timer = 0;
+	e->title_shown = usec();
+	for_windows(i, c) if (c->window == w && c->manage)
+		defer_bar(c->spot, c->monitor);
+}
+
+// 1 if a title change may refresh the bar now. otherwise the refresh is
+// pushed to the end of the window's interval
+int title_allowed(Window w)
+{
+	cached *e = cache_get(w); long long now = usec();
+	long long due = e->title_shown + TITLE_INTERVAL * 1000LL;
+	e->title_updates++;
+	if (TITLE_INTERVAL > 0 && now < due)
+	{
+		if (!e->title_timer)
+			e->title_timer = timer_add(due - now, title_refresh, (void*)(uintptr_t)w);
+		// no timer to show it later, so show it now
+		if (e->title_timer)
+		{
+			e->title_throttled++;
+			return 0;
+		}
+	}
+	e->title_shown = now;
+	return 1;
+}
+
 void property_notify(XEvent *ev)
 {
 	XPropertyEvent *e = &ev->xproperty;
 
+	int title = cache_property(e->window, e->atom), other = !title;
+	int unmapped = prefetch_property(e->window, e->atom);
+
+	// prevent spam
+	while (XCheckTypedWindowEvent(display, e->window, PropertyNotify, ev))
+	{
+		if (cache_property(e->window, e->atom)) title = 1;
+		else other = 1;
+		prefetch_property(e->window, e->atom);
+	}
+
+	// not mapped yet, so nothing on screen to update
+	if (unmapped) return;
+
+	if (title && !title_allowed(e->window))
+	{
+		title = 0;
+		if (!other) return;
+	}
+
 	client *c = window_build_client(e->window);
 	if (c && c->visible && c->manage)
 	{
 		client_update_border(c);
-		if (e->atom == atoms[WM_NAME] || e->atom == atoms[_NET_WM_NAME])
-			spot_update_bar(c->spot, c->monitor);
+		if (title) defer_bar(c->spot, c->monitor);
 	}
 	client_free(c);
+}
 
-	// prevent spam
-	while (XCheckTypedWindowEvent(display, ev->xproperty.window, PropertyNotify, ev));
+void expose(XEvent *ev)
+{
+	int i, j, bars = 0, lines = 0; monitor *m;
+	// content is unchanged; just repaint whatever was exposed
+	do {
+		if (menu_window(ev->xexpose.window)) lines = 1;
+		else bars = 1;
+	} while (XCheckTypedEvent(display, Expose, ev));
+	if (lines && menu.active)
+		menu_draw();
+	if (bars && TITLE) for_monitors(i, m) for_spots(j)
+		if (m->bar_state[j]) spot_draw_bar(j, i);
+}
+
+void destroy_notify(XEvent *e)
+{
+	cache_forget(e->xdestroywindow.window);
+	if (buttons_free == e->xdestroywindow.window)
+		buttons_free = None;
+	prefetch_forget(e->xdestroywindow.window);
+	focus_forget(e->xdestroywindow.window);
+	ewmh_client_remove(e->xdestroywindow.window);
+}
+
+// focus events that cannot change anything we draw: grab noise and moves
+// within or between a window's own hierarchy
+int focus_filter(XEvent *ev)
+{
+	XFocusChangeEvent *e = &ev->xfocus;
+	if (e->mode == NotifyGrab || e->mode == NotifyUngrab)
+		return 0;
+	if (e->detail == NotifyPointer || e->detail == NotifyPointerRoot || e->detail == NotifyDetailNone
+		|| e->detail == NotifyInferior || e->detail == NotifyVirtual || e->detail == NotifyNonlinearVirtual)
+		return 0;
+	return 1;
+}
+
+// Override-redirect windows (menus, tooltips, drag icons) are never ours.
+// Their events carry the flag, or for unmap and destroy the window is
+// remembered from its CreateNotify, so they are dropped before any request
+// goes out. A MapRequest shows the flag was cleared and forgets the window.
+
+#define UNMANAGED 64
+
+Window unmanaged[UNMANAGED];
+int nunmanaged, unmanaged_next;
+
+int unmanaged_index(Window w)
+{
+	for (int i = 0; i < nunmanaged; i++)
+		if (unmanaged[i] == w) return i;
+	return -1;
+}
+
+void unmanaged_add(Window w)
+{
+	if (unmanaged_index(w) >= 0) return;
+	if (nunmanaged < UNMANAGED) unmanaged[nunmanaged++] = w;
+	else unmanaged[unmanaged_next++ % UNMANAGED] = w;
+}
+
+void unmanaged_remove(Window w)
+{
+	int i = unmanaged_index(w);
+	if (i >= 0) unmanaged[i] = unmanaged[--nunmanaged];
+}
+
+int create_filter(XEvent *ev)
+{
+	if (!ev->xcreatewindow.override_redirect) return 1;
+	unmanaged_add(ev->xcreatewindow.window);
+	return 0;
+}
+
+int configure_filter(XEvent *ev)
+{
+	return !ev->xconfigure.override_redirect;
+}
+
+int map_filter(XEvent *ev)
+{
+	return !ev->xmap.override_redirect;
+}
+
+// only windows we listed, or the focused one, can need anything on unmap.
+// a full list may be missing some, so then let everything through
+int unmap_filter(XEvent *ev)
+{
+	Window w = ev->xunmap.window;
+	if (w == current) return 1;
+	if (unmanaged_index(w) >= 0) return 0;
+	return nclient_list == CLIENT_LIST || ewmh_client_index(w) >= 0;
 }
 
-void expose(XEvent *e)
+int destroy_filter(XEvent *ev)
 {
-	while (XCheckTypedEvent(display, Expose, e));
-	update_bars();
+	if (unmanaged_index(ev->xdestroywindow.window) < 0) return 1;
+	unmanaged_remove(ev->xdestroywindow.window);
+	return 0;
 }
 
 void any_event(XEvent *e)
@@ -24,13 +24,49 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
+#define CLIENT_LIST 256
+
+// _NET_CLIENT_LIST in mapping order, and the last _NET_CLIENT_LIST_STACKING
+// written. both are kept so the root properties only change when needed
+Window client_list[CLIENT_LIST], stacking_list[STACK];
+int nclient_list, nstacking_list = -1;
+
+int ewmh_client_index(Window w)
+{
+	for (int i = 0; i < nclient_list; i++)
+		if (client_list[i] == w) return i;
+	return -1;
+}
+
+void ewmh_client_reset()
+{
+	nclient_list = 0;
+	SETPROP_WIND(root, atoms[_NET_CLIENT_LIST], client_list, 0);
+}
+
+void ewmh_client_add(Window w)
+{
+	if (ewmh_client_index(w) >= 0 || nclient_list == CLIENT_LIST) return;
+	client_list[nclient_list++] = w;
+	XChangeProperty(display, root, atoms[_NET_CLIENT_LIST], XA_WINDOW, 32, PropModeAppend, (unsigned char*)&w, 1);
+}
+
+void ewmh_client_remove(Window w)
+{
+	int i = ewmh_client_index(w);
+	if (i < 0) return;
+	memmove(&client_list[i], &client_list[i+1], sizeof(Window) * (--nclient_list - i));
+	SETPROP_WIND(root, atoms[_NET_CLIENT_LIST], client_list, nclient_list);
+}
+
 void ewmh_client_list()
 {
 	int i; client *c; STACK_INIT(wins);
 	for_windows_rev(i, c) if (c->manage)
 		wins.windows[wins.depth++] = c->window;
-	SETPROP_WIND(root, atoms[_NET_CLIENT_LIST_STACKING], wins.windows, wins.depth);
-	// hack for now, since we dont track window mapping history
-	SETPROP_WIND(root, atoms[_NET_CLIENT_LIST], wins.windows, wins.depth);
+	if (wins.depth == nstacking_list && !memcmp(wins.windows, stacking_list, sizeof(Window) * wins.depth))
+		return;
+	nstacking_list = wins.depth;
+	memmove(stacking_list, wins.windows, sizeof(Window) * wins.depth);
+	SETPROP_WIND(root, atoms[_NET_CLIENT_LIST_STACKING], stacking_list, nstacking_list);
 }
-
@@ -0,0 +1,128 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Process launcher. Simple commands like "konsole" or "amixer -q sset Master
+// toggle" are split into argv once and started directly with posix_spawn.
+// Anything with shell syntax goes through /bin/sh -c. Children are reaped
+// from the event loop when its signalfd sees SIGCHLD.
+
+#define LAUNCHERS 64
+#define LAUNCH_ARGS 16
+#define LAUNCH_META "|&;<>()$`\\\"'*?[]#~{}\n"
+
+typedef struct {
+	char *cmd, *buf;
+	char *argv[LAUNCH_ARGS+1];
+} launcher;
+
+launcher launchers[LAUNCHERS];
+int nlaunchers;
+
+struct {
+	unsigned long spawned, failed, reaped, shell;
+	long long spawn_usec, spawn_max;
+} launches;
+
+extern char **environ;
+
+// split a command into argv. 0 = needs a shell
+int launch_parse(launcher *l, char *cmd)
+{
+	int n = 0; char *p;
+	memset(l, 0, sizeof(launcher));
+	if (strpbrk(cmd, LAUNCH_META)) return 0;
+
+	l->buf = strdup(cmd);
+	for (p = strtok(l->buf, " \t"); p; p = strtok(NULL, " \t"))
+	{
+		// env assignments and long commands are left to sh
+		if (n == LAUNCH_ARGS || (!n && strchr(p, '='))) break;
+		l->argv[n++] = p;
+	}
+	if (!n || p)
+	{
+		free(l->buf); l->buf = NULL;
+		return 0;
+	}
+	l->cmd = cmd;
+	return 1;
+}
+
+// tokenize the config.h commands once
+void launch_prepare()
+{
+	for (int i = 0; i < sizeof(keys)/sizeof(binding) && nlaunchers < LAUNCHERS; i++)
+		if ((keys[i].act == action_command || keys[i].act == action_find_or_start) && keys[i].data)
+			if (launch_parse(&launchers[nlaunchers], keys[i].data)) nlaunchers++;
+}
+
+void launch(char *cmd)
+{
+	int i, rc; pid_t pid; launcher tmp, *l = NULL;
+	posix_spawnattr_t attr; sigset_t none;
+	if (!cmd || !cmd[0]) return;
+
+	for (i = 0; i < nlaunchers && !l; i++)
+		if (launchers[i].cmd == cmd || !strcmp(launchers[i].cmd, cmd))
+			l = &launchers[i];
+
+	if (!l && launch_parse(&tmp, cmd))
+		l = &tmp;
+
+	// children start in their own session with nothing blocked
+	sigemptyset(&none);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID|POSIX_SPAWN_SETSIGMASK);
+	posix_spawnattr_setsigmask(&attr, &none);
+
+	long long start = usec();
+	if (l) rc = posix_spawnp(&pid, l->argv[0], NULL, &attr, l->argv, environ);
+	else
+	{
+		char *argv[] = { "sh", "-c", cmd, NULL };
+		rc = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, environ);
+		launches.shell++;
+	}
+	long long took = usec() - start;
+	posix_spawnattr_destroy(&attr);
+	if (l == &tmp) free(tmp.buf);
+
+	if (rc)
+	{
+		launches.failed++;
+		warnx("launch failed: %s: %s", cmd, strerror(rc));
+		return;
+	}
+	launches.spawned++;
+	launches.spawn_usec += took;
+	launches.spawn_max = MAX(launches.spawn_max, took);
+}
+
+// SIGCHLD arrived via the loop's signalfd
+void launch_reap()
+{
+	while (0 < waitpid(-1, NULL, WNOHANG)) launches.reaped++;
+}
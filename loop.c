@@ -0,0 +1,165 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Everything the main loop sleeps on besides the X connection: a signalfd
+// for SIGCHLD/SIGTERM/SIGINT/SIGHUP, a timerfd armed only while timers are
+// pending, and any other fds registered with loop_watch(). When idle with
+// no timers, poll() blocks indefinitely; there are no periodic wakeups.
+
+#define WATCHES 8
+#define TIMERS 32
+
+typedef void (*timer_fn)(void*);
+
+struct {
+	int fd;
+	void (*fn)(int);
+} watches[WATCHES];
+
+struct {
+	long long when;
+	timer_fn fn;
+	void *data;
+} timers[TIMERS];
+
+int nwatches, signal_fd = -1, timer_fd = -1;
+
+struct {
+	unsigned long wakeups, signals, timers;
+} loop_stats;
+
+void loop_watch(int fd, void (*fn)(int))
+{
+	if (fd < 0 || nwatches == WATCHES) return;
+	watches[nwatches].fd = fd;
+	watches[nwatches++].fn = fn;
+}
+
+// arm the timerfd for the earliest timer, or disarm it
+void loop_arm()
+{
+	struct itimerspec its; long long next = 0;
+	memset(&its, 0, sizeof(its));
+	for (int i = 0; i < TIMERS; i++)
+		if (timers[i].fn && (!next || timers[i].when < next))
+			next = timers[i].when;
+	if (next)
+	{
+		its.it_value.tv_sec  = next / 1000000;
+		its.it_value.tv_nsec = next % 1000000 * 1000 + 1;
+	}
+	timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// run fn once, delay microseconds from now. returns an id for timer_cancel
+int timer_add(long long delay, timer_fn fn, void *data)
+{
+	for (int i = 0; i < TIMERS; i++) if (!timers[i].fn)
+	{
+		timers[i].when = usec() + delay;
+		timers[i].fn   = fn;
+		timers[i].data = data;
+		loop_arm();
+		return i+1;
+	}
+	warnx("out of timers");
+	return 0;
+}
+
+void timer_cancel(int id)
+{
+	if (id < 1 || id > TIMERS) return;
+	timers[id-1].fn = NULL;
+	loop_arm();
+}
+
+void loop_timers(int fd)
+{
+	uint64_t expired; long long now = usec(); timer_fn fn;
+	while (read(fd, &expired, sizeof(expired)) == sizeof(expired));
+	for (int i = 0; i < TIMERS; i++)
+	{
+		if (!(fn = timers[i].fn) || timers[i].when > now) continue;
+		timers[i].fn = NULL;
+		loop_stats.timers++;
+		fn(timers[i].data);
+	}
+	loop_arm();
+}
+
+void loop_signals(int fd)
+{
+	struct signalfd_siginfo si; int child = 0;
+	while (read(fd, &si, sizeof(si)) == sizeof(si))
+	{
+		loop_stats.signals++;
+		if (si.ssi_signo == SIGCHLD) child = 1;
+		if (si.ssi_signo == SIGTERM || si.ssi_signo == SIGINT)
+		{
+			warnx("exit!");
+			exit(EXIT_SUCCESS);
+		}
+		if (si.ssi_signo == SIGHUP)
+		{
+			warnx("reload!");
+			settings_reload();
+		}
+	}
+	if (child) launch_reap();
+}
+
+void loop_init()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGHUP);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	signal_fd = signalfd(-1, &mask, SFD_NONBLOCK|SFD_CLOEXEC);
+	timer_fd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+	loop_watch(signal_fd, loop_signals);
+	loop_watch(timer_fd, loop_timers);
+}
+
+// sleep until the X connection or a watched fd is readable
+void loop_wait()
+{
+	struct pollfd fds[WATCHES+1]; int i;
+	fds[0].fd = ConnectionNumber(display);
+	fds[0].events = POLLIN;
+	for (i = 0; i < nwatches; i++)
+	{
+		fds[i+1].fd = watches[i].fd;
+		fds[i+1].events = POLLIN;
+	}
+	if (poll(fds, nwatches+1, -1) <= 0) return;
+	loop_stats.wakeups++;
+	for (i = 0; i < nwatches; i++)
+		if (fds[i+1].revents & POLLIN) watches[i].fn(watches[i].fd);
+}
@@ -0,0 +1,243 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Keyboard-driven overlay: an editable input line over a list of matches.
+// A source hands over an array of item strings when the menu opens, and
+// matching runs in memory on every keystroke. When the query only grows,
+// the previous matches are narrowed instead of rescanning every item.
+
+#define MENU_LINES 10
+
+typedef int (*menu_match)(const char *item, const char *query);
+typedef void (*menu_accept)(int item, const char *query);
+
+struct {
+	textbox *input, *lines[MENU_LINES];
+	short shown[MENU_LINES];
+	int active, selected, nitems, nmatches;
+	char **items, *query;
+	int *matches, *scores, *sorted;
+	menu_match match;
+	menu_accept accept;
+} menu;
+
+textbox* menu_textbox(unsigned long flags)
+{
+	XSetWindowAttributes attr; attr.override_redirect = True;
+	textbox *tb = textbox_create(root, TB_AUTOHEIGHT|TB_LEFT|flags, 0, 0, 1, 0, MENU_FONT, MENU_FG, MENU_BG, NULL, NULL);
+	// not a client; keep it out of window_build_client's hands
+	XChangeWindowAttributes(display, tb->window, CWOverrideRedirect, &attr);
+	XSelectInput(display, tb->window, ExposureMask);
+	return tb;
+}
+
+// 1 for the input line or any list line
+int menu_window(Window w)
+{
+	if (!menu.input) return 0;
+	if (menu.input->window == w) return 1;
+	for (int i = 0; i < MENU_LINES; i++)
+		if (menu.lines[i]->window == w) return 1;
+	return 0;
+}
+
+// score every candidate, then order by score, keeping item order within a score
+void menu_filter()
+{
+	int i, j, n = 0, best = 0, from = menu.nmatches;
+	char *query = menu.input->text;
+	int narrow = menu.query && !strncmp(query, menu.query, strlen(menu.query));
+
+	if (!narrow)
+		for (i = 0, from = menu.nitems; i < menu.nitems; i++) menu.matches[i] = i;
+
+	for (i = 0; i < from; i++)
+	{
+		int item = menu.matches[i], score = menu.match(menu.items[item], query);
+		if (score <= 0) continue;
+		menu.matches[n] = item;
+		menu.scores[n++] = score;
+		best = MAX(best, score);
+	}
+	for (j = 0; best > 0; best--)
+		for (i = 0; i < n; i++) if (menu.scores[i] == best)
+			menu.sorted[j++] = menu.matches[i];
+	memmove(menu.matches, menu.sorted, sizeof(int) * j);
+	menu.nmatches = j;
+
+	free(menu.query);
+	menu.query = strdup(query);
+	menu.selected = MIN(menu.selected, MAX(0, menu.nmatches-1));
+}
+
+void menu_draw()
+{
+	int i, state; textbox *tb;
+	textbox_draw(menu.input);
+	for (i = 0; i < MENU_LINES; i++)
+	{
+		tb = menu.lines[i];
+		state = i < menu.nmatches ? (i == menu.selected ? 2: 1): 0;
+		if (!state)
+		{
+			if (menu.shown[i]) textbox_hide(tb);
+			menu.shown[i] = 0;
+			continue;
+		}
+		if (state != menu.shown[i])
+			textbox_font(tb, MENU_FONT, state == 2 ? MENU_HLFG: MENU_FG, state == 2 ? MENU_HLBG: MENU_BG);
+		textbox_text(tb, menu.items[menu.matches[i]]);
+		// map first; anything drawn on an unmapped window is lost
+		if (!menu.shown[i]) textbox_show(tb);
+		textbox_draw(tb);
+		menu.shown[i] = state;
+	}
+}
+
+void menu_close()
+{
+	int i;
+	if (!menu.active) return;
+	XUngrabKeyboard(display, CurrentTime);
+	textbox_hide(menu.input);
+	for (i = 0; i < MENU_LINES; i++)
+		{ if (menu.shown[i]) textbox_hide(menu.lines[i]); menu.shown[i] = 0; }
+	free(menu.matches); free(menu.scores); free(menu.sorted); free(menu.query);
+	menu.matches = menu.scores = menu.sorted = NULL; menu.query = NULL;
+	menu.active = 0;
+}
+
+// items must stay valid until accept or close
+void menu_open(char *prompt, char **items, int nitems, menu_match match, menu_accept accept)
+{
+	int i; monitor *m = &monitors[current_mon];
+	menu_close();
+
+	if (!menu.input)
+	{
+		menu.input = menu_textbox(TB_EDITABLE);
+		for (i = 0; i < MENU_LINES; i++)
+			menu.lines[i] = menu_textbox(0);
+	}
+	int w = m->w/2, x = m->x + m->w/4, y = m->y + m->h/5, h = menu.input->h;
+	textbox_moveresize(menu.input, x, y, w, h);
+	for (i = 0; i < MENU_LINES; i++)
+		textbox_moveresize(menu.lines[i], x, y + h*(i+1), w, h);
+
+	menu.items    = items;
+	menu.nitems   = nitems;
+	menu.match    = match;
+	menu.accept   = accept;
+	menu.matches  = calloc(MAX(1, nitems), sizeof(int));
+	menu.scores   = calloc(MAX(1, nitems), sizeof(int));
+	menu.sorted   = calloc(MAX(1, nitems), sizeof(int));
+	menu.selected = 0;
+	menu.active   = 1;
+
+	textbox_prompt(menu.input, prompt);
+	textbox_text(menu.input, "");
+	textbox_cursor_end(menu.input);
+	menu_filter();
+
+	textbox_show(menu.input);
+	XRaiseWindow(display, menu.input->window);
+	for (i = 0; i < MENU_LINES; i++)
+		XRaiseWindow(display, menu.lines[i]->window);
+	// without the keyboard nothing could reach the menu, Escape included
+	if (XGrabKeyboard(display, menu.input->window, True, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess)
+	{
+		warnx("menu: keyboard grab failed");
+		menu_close();
+		return;
+	}
+	menu_draw();
+}
+
+void menu_key(XEvent *ev)
+{
+	// shifted column, so Shift+Tab arrives as ISO_Left_Tab
+	KeySym key = XLookupKeysym(&ev->xkey, ev->xkey.state & ShiftMask ? 1: 0);
+	int rc, item;
+
+	if (key == XK_Escape)
+		{ menu_close(); return; }
+
+	if (key == XK_Down || key == XK_Tab)
+		menu.selected = menu.nmatches ? (menu.selected+1) % MIN(menu.nmatches, MENU_LINES): 0;
+	else
+	if (key == XK_Up || key == XK_ISO_Left_Tab)
+		menu.selected = menu.nmatches ? (menu.selected+MIN(menu.nmatches, MENU_LINES)-1) % MIN(menu.nmatches, MENU_LINES): 0;
+	else
+	if ((rc = textbox_keypress(menu.input, ev)) < 0)
+	{
+		item = menu.nmatches ? menu.matches[menu.selected]: -1;
+		char *query = strdup(menu.input->text);
+		menu_accept accept = menu.accept;
+		menu_close();
+		accept(item, query);
+		free(query);
+		return;
+	}
+	else
+	if (rc > 0)
+		menu_filter();
+
+	menu_draw();
+}
+
+// window switcher source: class and title of every managed window, taken
+// from the window cache when the menu opens
+
+char switcher_labels[STACK][256], *switcher_items[STACK];
+Window switcher_windows[STACK];
+
+int switcher_match(const char *item, const char *query)
+{
+	if (!*query || !strncasecmp(item, query, strlen(query))) return 2;
+	return strcasestr(item, query) ? 1: 0;
+}
+
+void switcher_accept(int item, const char *query)
+{
+	client *c;
+	if (item < 0) return;
+	if ((c = window_build_client(switcher_windows[item])) && c->manage && c->visible)
+		client_activate(c);
+	client_free(c);
+}
+
+void switcher_open()
+{
+	int i, n = 0; client *c; char *title;
+	for_windows(i, c) if (c->manage && n < STACK)
+	{
+		title = cache_title(c->window);
+		snprintf(switcher_labels[n], sizeof(switcher_labels[n]), "%-16s %s", c->class ? c->class: "", title ? title: "");
+		switcher_items[n] = switcher_labels[n];
+		switcher_windows[n++] = c->window;
+	}
+	menu_open("window: ", switcher_items, n, switcher_match, switcher_accept);
+}
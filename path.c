@@ -0,0 +1,210 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// In-memory index of the executables on $PATH for the run prompt. Built
+// the first time the prompt opens, then kept current one name at a time
+// from inotify events, a moment after they settle; the prompt itself never
+// touches the disk.
+
+#define PATH_DIRS 32
+#define PATH_DELAY 500000
+#define PATH_PENDING 64
+#define PATH_EVENTS (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ATTRIB)
+
+char *path_dirs[PATH_DIRS], **path_items, path_pending[PATH_PENDING][256];
+int npath_dirs, npath_items, path_size, path_fd = -1, path_timer;
+int npath_pending, path_built, path_stale;
+
+int path_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char**)a, *(char**)b);
+}
+
+void path_add(char *name)
+{
+	if (npath_items == path_size)
+	{
+		path_size = MAX(256, path_size*2);
+		path_items = realloc(path_items, sizeof(char*) * path_size);
+	}
+	path_items[npath_items++] = strdup(name);
+}
+
+int path_executable(int fd, char *name)
+{
+	struct stat st;
+	return !fstatat(fd, name, &st, 0) && S_ISREG(st.st_mode) && !faccessat(fd, name, X_OK, 0);
+}
+
+void path_scan(char *dir)
+{
+	DIR *d; struct dirent *de;
+	if (!(d = opendir(dir))) return;
+	while ((de = readdir(d)))
+		if (de->d_name[0] != '.' && path_executable(dirfd(d), de->d_name))
+			path_add(de->d_name);
+	closedir(d);
+}
+
+void path_rebuild()
+{
+	int i, j;
+	while (npath_items) free(path_items[--npath_items]);
+	for (i = 0; i < npath_dirs; i++)
+		path_scan(path_dirs[i]);
+
+	// sorted, one entry per name
+	qsort(path_items, npath_items, sizeof(char*), path_cmp);
+	for (i = 0, j = 0; i < npath_items; i++)
+	{
+		if (j && !strcmp(path_items[j-1], path_items[i])) free(path_items[i]);
+		else path_items[j++] = path_items[i];
+	}
+	npath_items = j;
+	path_built = 1;
+	path_stale = 0;
+	npath_pending = 0;
+}
+
+// one name changed somewhere on $PATH: look for it in each directory and
+// add it to or drop it from the sorted index
+void path_update(char *name)
+{
+	char file[1024], *item; int i, lo = 0, hi = npath_items, cmp = 1, found = 0;
+	for (i = 0; i < npath_dirs && !found; i++)
+	{
+		snprintf(file, sizeof(file), "%s/%s", path_dirs[i], name);
+		found = path_executable(AT_FDCWD, file);
+	}
+	// lo ends on the name, or where it belongs
+	while (lo < hi)
+	{
+		i = (lo + hi) / 2;
+		if (!(cmp = strcmp(path_items[i], name))) { lo = i; break; }
+		if (cmp < 0) lo = i+1; else hi = i;
+	}
+	if (!cmp && !found)
+	{
+		free(path_items[lo]);
+		npath_items--;
+		memmove(&path_items[lo], &path_items[lo+1], sizeof(char*) * (npath_items - lo));
+	}
+	else
+	if (cmp && found)
+	{
+		path_add(name);
+		item = path_items[npath_items-1];
+		memmove(&path_items[lo+1], &path_items[lo], sizeof(char*) * (npath_items-1 - lo));
+		path_items[lo] = item;
+	}
+}
+
+void path_refresh(void *data)
+{
+	path_timer = 0;
+	// the open prompt points at the current index; wait for it to close
+	if (menu.active && menu.items == path_items)
+	{
+		path_timer = timer_add(PATH_DELAY, path_refresh, NULL);
+		return;
+	}
+	// too much changed to track by name; scan again when next needed
+	if (path_stale)
+		path_built = 0;
+	else
+		for (int i = 0; i < npath_pending; i++)
+			path_update(path_pending[i]);
+	npath_pending = 0;
+	path_stale = 0;
+}
+
+// inotify fired. installs touch many files at once, so collect the names
+// and settle first
+void path_changed(int fd)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event)))); ssize_t len; int i;
+	struct inotify_event *ev;
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+		for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len)
+		{
+			ev = (struct inotify_event*)p;
+			if (!path_built || !ev->len || ev->name[0] == '.') continue;
+			for (i = 0; i < npath_pending && strcmp(path_pending[i], ev->name); i++);
+			if (i < npath_pending) continue;
+			if (npath_pending == PATH_PENDING || strlen(ev->name) >= sizeof(path_pending[0]))
+				path_stale = 1;
+			else
+				strcpy(path_pending[npath_pending++], ev->name);
+		}
+	if (path_built && (npath_pending || path_stale) && !path_timer)
+		path_timer = timer_add(PATH_DELAY, path_refresh, NULL);
+}
+
+// directories and watches only; the index is built by the first run_open
+void path_init()
+{
+	char *path = getenv("PATH"), *dir;
+	if (!path) return;
+
+	path_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	path = strdup(path);
+	for (dir = strtok(path, ":"); dir && npath_dirs < PATH_DIRS; dir = strtok(NULL, ":"))
+	{
+		if (!*dir) continue;
+		path_dirs[npath_dirs++] = strdup(dir);
+		if (path_fd >= 0) inotify_add_watch(path_fd, dir, PATH_EVENTS);
+	}
+	free(path);
+
+	loop_watch(path_fd, path_changed);
+}
+
+// prefix, then substring, then the query's letters in order
+int run_match(const char *item, const char *query)
+{
+	const char *q = query;
+	if (!strncmp(item, query, strlen(query))) return 3;
+	if (strstr(item, query)) return 2;
+	for (; *item && *q; item++) if (*item == *q) q++;
+	return *q ? 0: 1;
+}
+
+// a query with arguments, or one matching nothing, is run as typed
+void run_accept(int item, const char *query)
+{
+	if (item < 0 && !*query)
+		return;
+	if (item < 0 || strchr(query, ' '))
+		launch((char*)query);
+	else
+		launch(path_items[item]);
+}
+
+void run_open()
+{
+	if (!path_built) path_rebuild();
+	menu_open("run: ", path_items, npath_items, run_match, run_accept);
+}
@@ -0,0 +1,157 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Remember where each WM_CLASS/WM_WINDOW_ROLE was last put, so apps land
+// in the right spot on their first map. The table is a small open-addressed
+// hash in a shared file mapping; the kernel does the writeback.
+
+#define PLACES 256
+#define PLACES_PROBE 8
+#define PLACES_MAGIC 0x786f6174
+
+typedef struct {
+	unsigned long hash;
+	char class[32], role[32];
+	short monitor, spot, maxv, maxh;
+} place;
+
+typedef struct {
+	unsigned int magic, size;
+	place table[PLACES];
+} places_map;
+
+places_map *places;
+
+void places_open()
+{
+	char path[1024]; char *home = getenv("HOME"); int fd;
+	if (!PLACES_FILE || !home) return;
+
+	snprintf(path, sizeof(path), "%s/%s", home, PLACES_FILE);
+	if ((fd = open(path, O_RDWR|O_CREAT, 0600)) < 0) return;
+
+	if (ftruncate(fd, sizeof(places_map)) == 0)
+	{
+		places = mmap(NULL, sizeof(places_map), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		if (places == MAP_FAILED) places = NULL;
+	}
+	close(fd);
+
+	// layout changed or fresh file
+	if (places && (places->magic != PLACES_MAGIC || places->size != sizeof(place)))
+	{
+		memset(places, 0, sizeof(places_map));
+		places->magic = PLACES_MAGIC;
+		places->size  = sizeof(place);
+	}
+}
+
+// the bits of a client that form the key. a prefetched client already has
+// them and primes the cache; otherwise only a cached copy will do when
+// fetch is 0, so map_request never asks the server
+int places_key(client *c, char *class, char *role, int fetch)
+{
+	cached *e;
+	*class = 0; *role = 0;
+
+	if (c->prefetched)
+	{
+		e = cache_get(c->window);
+		snprintf(e->class, sizeof(e->class), "%s", c->class ? c->class: "");
+		snprintf(e->role,  sizeof(e->role),  "%s", c->role  ? c->role: "");
+		e->classed = 1;
+	}
+	e = cache_find(c->window);
+	if (!fetch && !(e && e->classed))
+		return 0;
+	cache_class(c->window, class, role);
+	return *class ? 1:0;
+}
+
+unsigned long places_hash(char *class, char *role)
+{
+	unsigned long h = 5381;
+	while (*class) h = h * 33 + *class++;
+	h = h * 33;
+	while (*role) h = h * 33 + *role++;
+	return h ? h: 1;
+}
+
+place* places_find(char *class, char *role, int create)
+{
+	unsigned long hash = places_hash(class, role); place *p;
+	for (int i = 0; i < PLACES_PROBE; i++)
+	{
+		p = &places->table[(hash + i) % PLACES];
+		if (p->hash == hash && !strcmp(p->class, class) && !strcmp(p->role, role))
+			return p;
+		if (!p->hash)
+			break;
+	}
+	if (!create) return NULL;
+
+	// reuse the home slot if the probe run is full
+	for (int i = 0; i < PLACES_PROBE; i++)
+	{
+		p = &places->table[(hash + i) % PLACES];
+		if (!p->hash) break;
+	}
+	if (p->hash) p = &places->table[hash % PLACES];
+
+	memset(p, 0, sizeof(place));
+	p->hash = hash;
+	snprintf(p->class, sizeof(p->class), "%s", class);
+	snprintf(p->role,  sizeof(p->role),  "%s", role);
+	return p;
+}
+
+// where did this class/role go last time?
+int places_recall(client *c, int *spot, int *mon, int *maxv, int *maxh)
+{
+	char class[32], role[32]; place *p;
+	if (!places || c->transient || c->type == atoms[_NET_WM_WINDOW_TYPE_DIALOG])
+		return 0;
+	if (!places_key(c, class, role, 0) || !(p = places_find(class, role, 0)))
+		return 0;
+	if (p->monitor >= nmonitors || p->spot < SPOT1 || p->spot > SPOT3)
+		return 0;
+	*spot = p->spot; *mon = p->monitor; *maxv = p->maxv; *maxh = p->maxh;
+	return 1;
+}
+
+void places_remember(client *c)
+{
+	char class[32], role[32]; place *p;
+	if (!places || !c || !c->manage || c->transient || c->type == atoms[_NET_WM_WINDOW_TYPE_DIALOG])
+		return;
+	if (places_key(c, class, role, 1) && (p = places_find(class, role, 1)))
+	{
+		p->monitor = c->monitor;
+		p->spot    = c->spot;
+		p->maxv    = c->maxv;
+		p->maxh    = c->maxh;
+	}
+}
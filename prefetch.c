@@ -0,0 +1,202 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Properties gathered at CreateNotify for windows that have not mapped yet.
+// PropertyNotify and ConfigureNotify keep them current, so the MapRequest
+// that follows can place the window without asking the server again.
+
+#define PREFETCH 32
+
+typedef struct {
+	client c;
+	char class[32], role[32];
+	short hinted_urgent;
+	long sized;
+	XSizeHints size;
+} prefetch;
+
+prefetch prefetches[PREFETCH];
+int prefetch_next;
+
+struct {
+	unsigned long stored, used, missed, refreshed;
+} prefetch_stats;
+
+prefetch* prefetch_find(Window w)
+{
+	for (int i = 0; i < PREFETCH; i++)
+		if (prefetches[i].c.window == w) return &prefetches[i];
+	return NULL;
+}
+
+void prefetch_forget(Window w)
+{
+	prefetch *p = prefetch_find(w);
+	if (p) memset(p, 0, sizeof(prefetch));
+}
+
+void prefetch_states(prefetch *p)
+{
+	client *c = &p->c;
+	if (!GETPROP_ATOM(c->window, atoms[_NET_WM_STATE], c->states, ATOMLIST))
+		memset(c->states, 0, sizeof(Atom) * ATOMLIST);
+	c->full   = client_has_state(c, atoms[_NET_WM_STATE_FULLSCREEN]);
+	c->maxv   = client_has_state(c, atoms[_NET_WM_STATE_MAXIMIZE_VERT]);
+	c->maxh   = client_has_state(c, atoms[_NET_WM_STATE_MAXIMIZE_HORZ]);
+	c->urgent = client_has_state(c, atoms[_NET_WM_STATE_DEMANDS_ATTENTION]) || p->hinted_urgent;
+}
+
+void prefetch_hints(prefetch *p)
+{
+	XWMHints *hints; client *c = &p->c;
+	c->input = 0; p->hinted_urgent = 0;
+	TRACE_SYNC("XGetWMHints");
+	if ((hints = XGetWMHints(display, c->window)))
+	{
+		c->input = hints->flags & InputHint && hints->input ? 1:0;
+		p->hinted_urgent = hints->flags & XUrgencyHint ? 1:0;
+		XFree(hints);
+	}
+	c->urgent = client_has_state(c, atoms[_NET_WM_STATE_DEMANDS_ATTENTION]) || p->hinted_urgent;
+}
+
+void prefetch_class(prefetch *p)
+{
+	XClassHint chint; *p->class = 0;
+	TRACE_SYNC("XGetClassHint");
+	if (XGetClassHint(display, p->c.window, &chint))
+	{
+		snprintf(p->class, sizeof(p->class), "%s", chint.res_class);
+		XFree(chint.res_class); XFree(chint.res_name);
+	}
+}
+
+void prefetch_role(prefetch *p)
+{
+	char *tmp = window_get_text_prop(p->c.window, atoms[WM_WINDOW_ROLE]);
+	snprintf(p->role, sizeof(p->role), "%s", tmp ? tmp: "");
+}
+
+void prefetch_size(prefetch *p)
+{
+	long sr;
+	TRACE_SYNC("XGetWMNormalHints");
+	p->sized = XGetWMNormalHints(display, p->c.window, &p->size, &sr) ? 1:0;
+}
+
+// c is a manageable window from create_notify, already being listened to
+void prefetch_store(client *c)
+{
+	prefetch *p = &prefetches[prefetch_next++ % PREFETCH];
+	memset(p, 0, sizeof(prefetch));
+	p->c = *c;
+	p->c.class = NULL;
+	prefetch_hints(p);
+	prefetch_states(p);
+	prefetch_class(p);
+	prefetch_role(p);
+	prefetch_size(p);
+	prefetch_stats.stored++;
+}
+
+// re-read only what this property feeds. 1 if the window is a prefetched
+// one, ie, not mapped yet and not worth a full client build
+int prefetch_property(Window w, Atom atom)
+{
+	prefetch *p = prefetch_find(w); client *c;
+	if (!p) return 0;
+	c = &p->c;
+	prefetch_stats.refreshed++;
+
+	if (atom == atoms[_NET_WM_WINDOW_TYPE])
+		// may no longer be ours to manage; let map_request decide afresh
+		memset(p, 0, sizeof(prefetch));
+	else
+	if (atom == atoms[_NET_WM_STATE])
+		prefetch_states(p);
+	else
+	if (atom == XA_WM_HINTS)
+		prefetch_hints(p);
+	else
+	if (atom == XA_WM_CLASS)
+		prefetch_class(p);
+	else
+	if (atom == atoms[WM_WINDOW_ROLE])
+		prefetch_role(p);
+	else
+	if (atom == XA_WM_NORMAL_HINTS)
+		prefetch_size(p);
+	else
+	if (atom == XA_WM_TRANSIENT_FOR)
+	{
+		c->transient = None;
+		TRACE_SYNC("XGetTransientForHint");
+		XGetTransientForHint(display, c->window, &c->transient);
+	}
+	else
+	if (atom == atoms[WM_CLIENT_LEADER])
+	{
+		if (!GETPROP_WIND(c->window, atoms[WM_CLIENT_LEADER], &c->leader, 1)) c->leader = None;
+	}
+	else
+		prefetch_stats.refreshed--;
+	return 1;
+}
+
+// geometry comes with the event
+void prefetch_configure(XConfigureEvent *e)
+{
+	prefetch *p = prefetch_find(e->window);
+	if (!p) return;
+	p->c.attr.x = e->x; p->c.attr.y = e->y;
+	p->c.attr.width = e->width; p->c.attr.height = e->height;
+	p->c.attr.border_width = e->border_width;
+}
+
+// hand over the prefetched client for map_request, built in the arena like
+// any other, and drop the entry
+client* prefetch_take(Window w)
+{
+	prefetch *p = prefetch_find(w);
+	if (!p)
+	{
+		prefetch_stats.missed++;
+		return NULL;
+	}
+	client *c = arena_alloc(sizeof(client));
+	*c = p->c;
+	c->class = *p->class ? intern(p->class): NULL;
+	c->role  = intern(p->role);
+	if (p->sized)
+	{
+		c->size = arena_alloc(sizeof(XSizeHints));
+		*c->size = p->size;
+	}
+	c->prefetched = 1;
+	memset(p, 0, sizeof(prefetch));
+	prefetch_stats.used++;
+	return c;
+}
@@ -0,0 +1,227 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Optional title bar render thread. Bars are drawn over a second display
+// connection, so slow glyph rasterizing for fallback or CJK fonts happens
+// off the event loop. The loop composes the text as before and hands the
+// result, with the font and color names, over a single-producer,
+// single-consumer ring; an eventfd wakes the thread. Each bar has a
+// generation number, so a job overtaken by a newer one for the same bar, or
+// by an inline draw, is skipped.
+
+#define RENDER_JOBS 64
+#define RENDER_BARS (MONITORS * (SPOT3+1))
+#define RENDER_COLORS 8
+#define RENDER_GLYPHS 8
+
+typedef struct {
+	Window window;
+	unsigned long flags;
+	short w, h, bar;
+	unsigned int gen;
+	int size; // text buffer, kept with the slot and only ever grown
+	char *text, font[256], fg[64], bg[64];
+} render_job;
+
+render_job render_jobs[RENDER_JOBS];
+unsigned int render_head, render_tail, render_gen[RENDER_BARS];
+int render_wake = -1;
+
+Display *render_display;
+XftFont *render_font;
+char render_font_name[256];
+
+// focused and blurred bars alternate, so keep every color in use allocated
+struct {
+	char name[64];
+	XftColor color;
+	unsigned long used;
+} render_colors[RENDER_COLORS];
+unsigned long render_color_tick;
+
+struct {
+	unsigned long queued, drawn, skipped, inline_draws;
+} render_stats;
+
+// the thread's own colors by name, allocated once. when the table is full
+// the least recently used one goes
+XftColor* render_color(const char *name)
+{
+	int screen = DefaultScreen(render_display), i, slot = 0;
+	Visual *visual = DefaultVisual(render_display, screen);
+	Colormap map = DefaultColormap(render_display, screen);
+
+	for (i = 0; i < RENDER_COLORS; i++)
+	{
+		if (*render_colors[i].name && !strcmp(render_colors[i].name, name))
+		{
+			render_colors[i].used = ++render_color_tick;
+			return &render_colors[i].color;
+		}
+		if (render_colors[i].used < render_colors[slot].used)
+			slot = i;
+	}
+	pthread_mutex_lock(&xft_mutex);
+	if (*render_colors[slot].name)
+		XftColorFree(render_display, visual, map, &render_colors[slot].color);
+	XftColorAllocName(render_display, visual, map, name, &render_colors[slot].color);
+	pthread_mutex_unlock(&xft_mutex);
+	snprintf(render_colors[slot].name, sizeof(render_colors[slot].name), "%s", name);
+	render_colors[slot].used = ++render_color_tick;
+	return &render_colors[slot].color;
+}
+
+// the thread's own copy of the font, reopened only when a job asks for a
+// different one
+void render_style(render_job *j)
+{
+	if (strcmp(render_font_name, j->font))
+	{
+		pthread_mutex_lock(&xft_mutex);
+		if (render_font) XftFontClose(render_display, render_font);
+		render_font = XftFontOpenName(render_display, DefaultScreen(render_display), j->font);
+		pthread_mutex_unlock(&xft_mutex);
+		strcpy(render_font_name, j->font);
+	}
+}
+
+// rasterize what the text needs a few glyphs at a time, so the event loop
+// waits on xft_mutex for one small batch at most, never a whole bar. the
+// draw that follows then finds every glyph loaded
+void render_glyphs(const char *text)
+{
+	FT_UInt missing[XFT_NMISSING]; int nmissing, n, len = strlen(text); FcChar32 ch;
+	while (len > 0)
+	{
+		pthread_mutex_lock(&xft_mutex);
+		for (n = 0, nmissing = 0; n < RENDER_GLYPHS && len > 0; n++)
+		{
+			int step = utf8_next(text, len, &ch);
+			text += step; len -= step;
+			XftFontCheckGlyph(render_display, render_font, FcTrue, XftCharIndex(render_display, render_font, ch), missing, &nmissing);
+		}
+		if (nmissing) XftFontLoadGlyphs(render_display, render_font, FcTrue, missing, nmissing);
+		pthread_mutex_unlock(&xft_mutex);
+	}
+}
+
+void render_job_draw(render_job *j)
+{
+	textbox tb;
+	memset(&tb, 0, sizeof(textbox));
+	tb.flags = j->flags; tb.window = j->window;
+	tb.w = j->w; tb.h = j->h;
+	tb.text = j->text;
+	tb.font_name = j->font; tb.fg_name = j->fg; tb.bg_name = j->bg;
+
+	render_style(j);
+	if (!(tb.font = render_font)) return;
+	tb.color_fg = *render_color(j->fg);
+	tb.color_bg = *render_color(j->bg);
+	render_glyphs(j->text);
+	textbox_paint(render_display, &tb, 0, 0, 0);
+}
+
+void* render_main(void *arg)
+{
+	uint64_t n; unsigned int tail = render_tail; render_job *j;
+	for (;;)
+	{
+		if (read(render_wake, &n, sizeof(n)) < 0 && errno != EINTR)
+			break;
+		while (tail != __atomic_load_n(&render_head, __ATOMIC_ACQUIRE))
+		{
+			j = &render_jobs[tail % RENDER_JOBS];
+			if (j->gen == __atomic_load_n(&render_gen[j->bar], __ATOMIC_ACQUIRE))
+			{
+				render_job_draw(j);
+				__atomic_add_fetch(&render_stats.drawn, 1, __ATOMIC_RELAXED);
+			}
+			else
+				__atomic_add_fetch(&render_stats.skipped, 1, __ATOMIC_RELAXED);
+			__atomic_store_n(&render_tail, ++tail, __ATOMIC_RELEASE);
+		}
+		XFlush(render_display);
+	}
+	return NULL;
+}
+
+// 1 if the thread will draw the bar. 0 means draw it inline now
+int render_push(textbox *tb, int bar)
+{
+	unsigned int gen = __atomic_add_fetch(&render_gen[bar], 1, __ATOMIC_RELEASE);
+	unsigned int head = render_head;
+	uint64_t one = 1;
+
+	if (!render_display || head - __atomic_load_n(&render_tail, __ATOMIC_ACQUIRE) == RENDER_JOBS)
+	{
+		render_stats.inline_draws++;
+		return 0;
+	}
+	render_job *j = &render_jobs[head % RENDER_JOBS];
+	j->window = tb->window; j->flags = tb->flags;
+	j->w = tb->w; j->h = tb->h;
+	j->bar = bar; j->gen = gen;
+	int len = strlen(tb->text ? tb->text: "");
+	if (len+1 > j->size)
+	{
+		j->size = len+1;
+		j->text = realloc(j->text, j->size);
+	}
+	memmove(j->text, tb->text ? tb->text: "", len+1);
+	snprintf(j->font, sizeof(j->font), "%s", tb->font_name);
+	snprintf(j->fg, sizeof(j->fg), "%s", tb->fg_name);
+	snprintf(j->bg, sizeof(j->bg), "%s", tb->bg_name);
+	__atomic_store_n(&render_head, head+1, __ATOMIC_RELEASE);
+	render_stats.queued++;
+
+	if (write(render_wake, &one, sizeof(one)) < 0) {}
+	return 1;
+}
+
+void render_init()
+{
+	pthread_t thread; pthread_attr_t attr;
+	if (!TITLE_THREAD || !TITLE) return;
+
+	if (!(render_display = XOpenDisplay(NULL)))
+	{
+		warnx("render thread: cannot open display; drawing inline");
+		return;
+	}
+	fcntl(ConnectionNumber(render_display), F_SETFD, FD_CLOEXEC);
+	render_wake = eventfd(0, EFD_CLOEXEC);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (render_wake < 0 || pthread_create(&thread, &attr, render_main, NULL))
+	{
+		warnx("render thread: cannot start; drawing inline");
+		XCloseDisplay(render_display);
+		render_display = NULL;
+	}
+	pthread_attr_destroy(&attr);
+}
@@ -0,0 +1,331 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Optional runtime config file, $HOME/CONFIG_FILE. One setting per line:
+//
+//   border 3
+//   border_focus #3366cc
+//   spot1_width_pct 60
+//   bind Mod4+F1 command konsole
+//   bind Mod4+Shift+1 move SPOT1
+//
+// Anything not set keeps its config.h value. The file is read at startup
+// and again on SIGHUP or when it is written. A reload only applies what
+// changed: key grabs, border colors, bar styles, or the spot layout.
+
+#define SETTINGS_KEYS 64
+#define KEYS (int)(sizeof(keys)/sizeof(binding))
+
+typedef struct {
+	const char *name;
+	size_t offset, size; // size 0 for numbers
+	int min, max;
+} setting;
+
+#define SETTING_INT(n,lo,hi) { #n, offsetof(config, n), 0, (lo), (hi) }
+#define SETTING_STR(n) { #n, offsetof(config, n), sizeof(((config*)0)->n) }
+
+// numbers are clamped; a window must keep some size inside its spot
+setting settings_table[] = {
+	SETTING_INT(border, 0, 32),
+	SETTING_INT(gap, 0, 64),
+	SETTING_INT(spot1_width_pct, 10, 90),
+	SETTING_INT(spot2_height_pct, 10, 90),
+	SETTING_STR(title),
+	SETTING_STR(title_blur),
+	SETTING_STR(title_focus),
+	SETTING_STR(border_blur),
+	SETTING_STR(border_focus),
+	SETTING_STR(border_urgent),
+};
+
+struct {
+	const char *name;
+	void (*act)(void*, int, client*);
+	int command;
+} settings_actions[] = {
+	{ "move",            action_move            },
+	{ "focus",           action_focus           },
+	{ "move_direction",  action_move_direction  },
+	{ "focus_direction", action_focus_direction },
+	{ "close",           action_close           },
+	{ "cycle",           action_cycle           },
+	{ "raise_nth",       action_raise_nth       },
+	{ "command",         action_command,      1 },
+	{ "find_or_start",   action_find_or_start,1 },
+	{ "move_monitor",    action_move_monitor    },
+	{ "focus_monitor",   action_focus_monitor   },
+	{ "focus_previous",  action_focus_previous  },
+	{ "switcher",        action_switcher        },
+	{ "run",             action_run             },
+	{ "fullscreen",      action_fullscreen      },
+	{ "maximize_vert",   action_maximize_vert   },
+	{ "maximize_horz",   action_maximize_horz   },
+};
+
+struct {
+	const char *name;
+	int value;
+} settings_words[] = {
+	{ "SPOT1", SPOT1 }, { "SPOT2", SPOT2 }, { "SPOT3", SPOT3 },
+	{ "LEFT", LEFT }, { "RIGHT", RIGHT }, { "UP", UP }, { "DOWN", DOWN },
+	{ "Shift", ShiftMask }, { "Control", ControlMask }, { "Mod1", Mod1Mask }, { "Mod2", Mod2Mask },
+	{ "Mod3", Mod3Mask }, { "Mod4", Mod4Mask }, { "Mod5", Mod5Mask }, { "Any", AnyModifier },
+};
+
+// bindings from the file. searched before keys[]
+binding settings_keys[SETTINGS_KEYS];
+int nsettings_keys, settings_fd = -1;
+char settings_path[1024], *settings_name;
+
+int settings_word(const char *word, int *value)
+{
+	for (int i = 0; i < sizeof(settings_words)/sizeof(settings_words[0]); i++)
+		if (!strcmp(settings_words[i].name, word))
+			{ *value = settings_words[i].value; return 1; }
+	return 0;
+}
+
+void settings_defaults(config *cfg)
+{
+	memset(cfg, 0, sizeof(config));
+	cfg->border = BORDER;
+	cfg->gap = GAP;
+	cfg->spot1_width_pct = SPOT1_WIDTH_PCT;
+	cfg->spot2_height_pct = SPOT2_HEIGHT_PCT;
+	snprintf(cfg->title, sizeof(cfg->title), "%s", TITLE ? TITLE: "");
+	snprintf(cfg->title_blur, sizeof(cfg->title_blur), "%s", TITLE_BLUR);
+	snprintf(cfg->title_focus, sizeof(cfg->title_focus), "%s", TITLE_FOCUS);
+	snprintf(cfg->border_blur, sizeof(cfg->border_blur), "%s", BORDER_BLUR);
+	snprintf(cfg->border_focus, sizeof(cfg->border_focus), "%s", BORDER_FOCUS);
+	snprintf(cfg->border_urgent, sizeof(cfg->border_urgent), "%s", BORDER_URGENT);
+}
+
+// "Mod4+Shift+F1 command konsole"
+int settings_bind(char *spec, binding *b)
+{
+	char *combo = strtok(spec, " \t"), *action = strtok(NULL, " \t"), *arg = strtok(NULL, "");
+	char *part, *next; int i, mod;
+	if (!combo || !action) return 0;
+
+	memset(b, 0, sizeof(binding));
+	for (part = combo; (next = strchr(part, '+')); part = next+1)
+	{
+		*next = 0;
+		if (!settings_word(part, &mod)) return 0;
+		b->mod |= mod;
+	}
+	if ((b->key = XStringToKeysym(part)) == NoSymbol)
+		return 0;
+
+	for (i = 0; i < sizeof(settings_actions)/sizeof(settings_actions[0]); i++)
+		if (!strcmp(settings_actions[i].name, action)) break;
+	if (i == sizeof(settings_actions)/sizeof(settings_actions[0]))
+		return 0;
+	b->act = settings_actions[i].act;
+
+	while (arg && isspace(*arg)) arg++;
+	if (settings_actions[i].command)
+	{
+		if (!arg || !*arg) return 0;
+		b->data = strdup(arg);
+	}
+	else
+	if (arg && *arg && !settings_word(arg, &b->num))
+		b->num = strtol(arg, NULL, 0);
+	return 1;
+}
+
+// a missing file is not an error; it just means config.h values
+void settings_read(config *cfg, binding *binds, int *nbinds)
+{
+	char line[1024], *name, *value, *end; int n = 0, i; long num; FILE *f; setting *st;
+	settings_defaults(cfg);
+	*nbinds = 0;
+	if (!*settings_path || !(f = fopen(settings_path, "r")))
+		return;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		n++;
+		for (end = line + strlen(line); end > line && isspace(end[-1]); *--end = 0);
+		for (name = line; isspace(*name); name++);
+		if (!*name || *name == '#') continue;
+		for (value = name; *value && !isspace(*value); value++);
+		if (*value) *value++ = 0;
+		while (isspace(*value)) value++;
+
+		if (!strcmp(name, "bind"))
+		{
+			if (*nbinds < SETTINGS_KEYS && settings_bind(value, &binds[*nbinds])) (*nbinds)++;
+			else warnx("%s:%d: bad binding", settings_path, n);
+			continue;
+		}
+		for (i = 0; i < sizeof(settings_table)/sizeof(setting); i++)
+			if (!strcmp(settings_table[i].name, name)) break;
+		if (i == sizeof(settings_table)/sizeof(setting))
+		{
+			warnx("%s:%d: unknown setting %s", settings_path, n, name);
+			continue;
+		}
+		st = &settings_table[i];
+		if (st->size)
+		{
+			snprintf((char*)cfg + st->offset, st->size, "%s", value);
+			continue;
+		}
+		num = strtol(value, &end, 0);
+		if (end == value || *end)
+		{
+			warnx("%s:%d: %s needs a number", settings_path, n, name);
+			continue;
+		}
+		if (num < st->min || num > st->max)
+		{
+			warnx("%s:%d: %s limited to %d..%d", settings_path, n, name, st->min, st->max);
+			num = MAX(st->min, MIN(st->max, num));
+		}
+		*(int*)((char*)cfg + st->offset) = num;
+	}
+	fclose(f);
+}
+
+// grab or ungrab a key combination, with and without lock keys
+void key_grab(binding *b, int grab)
+{
+	unsigned int variants[] = { 0, LockMask, NumlockMask, LockMask|NumlockMask };
+	KeyCode code = XKeysymToKeycode(display, b->key);
+	for (int j = 0; j < (b->mod == AnyModifier ? 1: 4); j++)
+	{
+		if (grab) XGrabKey(display, code, b->mod|variants[j], root, True, GrabModeAsync, GrabModeAsync);
+		else XUngrabKey(display, code, b->mod|variants[j], root);
+	}
+}
+
+int key_bound(binding *b, binding *list, int n)
+{
+	for (int i = 0; i < n; i++)
+		if (list[i].key == b->key && list[i].mod == b->mod) return 1;
+	return 0;
+}
+
+// only command bindings carry data, and it is always ours
+void settings_keys_free()
+{
+	for (int i = 0; i < nsettings_keys; i++)
+		free(settings_keys[i].data);
+	nsettings_keys = 0;
+}
+
+// pick up the new settings, then redo only what depends on what changed
+void settings_reload()
+{
+	config old = settings; binding fresh[SETTINGS_KEYS]; int nfresh, i, j; client *c; monitor *m;
+	settings_read(&settings, fresh, &nfresh);
+
+	// grabs: drop combinations no longer bound anywhere, add new ones
+	for (i = 0; i < nsettings_keys; i++)
+		if (!key_bound(&settings_keys[i], fresh, nfresh) && !key_bound(&settings_keys[i], keys, KEYS))
+			key_grab(&settings_keys[i], 0);
+	for (i = 0; i < nfresh; i++)
+		if (!key_bound(&fresh[i], settings_keys, nsettings_keys) && !key_bound(&fresh[i], keys, KEYS))
+			key_grab(&fresh[i], 1);
+	settings_keys_free();
+	memmove(settings_keys, fresh, sizeof(binding) * nfresh);
+	nsettings_keys = nfresh;
+
+	int colors = strcmp(old.border_blur, settings.border_blur) || strcmp(old.border_focus, settings.border_focus)
+		|| strcmp(old.border_urgent, settings.border_urgent);
+	int font = TITLE && strcmp(old.title, settings.title);
+	int bars = font || strcmp(old.title_blur, settings.title_blur) || strcmp(old.title_focus, settings.title_focus) || colors;
+	int layout = font || old.border != settings.border || old.gap != settings.gap
+		|| old.spot1_width_pct != settings.spot1_width_pct || old.spot2_height_pct != settings.spot2_height_pct;
+
+	if (colors)
+	{
+		Colormap map = DefaultColormap(display, DefaultScreen(display));
+		unsigned long pixels[] = { pixel_focus, pixel_blur, pixel_urgent };
+		XFreeColors(display, map, pixels, 3, 0);
+		pixel_focus  = color_pixel(settings.border_focus);
+		pixel_blur   = color_pixel(settings.border_blur);
+		pixel_urgent = color_pixel(settings.border_urgent);
+	}
+
+	// windows are found in their spots before the spots move
+	if (layout || colors)
+		query_windows();
+
+	if (layout)
+	{
+		// a new font can change the bar height
+		if (font) for_monitors(i, m) for_spots(j)
+			textbox_font(m->bars[j], settings.title, settings.title_blur, settings.border_blur);
+		spot_layout();
+		for_windows(i, c) if (c->manage)
+			client_place_spot(c, c->spot, c->monitor, 0);
+	}
+	if (layout || colors)
+		for_windows(i, c) if (c->manage)
+			client_update_border(c);
+
+	if (TITLE && bars)
+		for_monitors(i, m) for_spots(j) m->bar_state[j] = -1;
+	if (TITLE && (bars || layout))
+		defer_bars();
+}
+
+// the file is often replaced rather than written, so watch its directory.
+// no IN_CREATE: that fires before anything is written
+void settings_changed(int fd)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event)))); ssize_t len; int hit = 0;
+	struct inotify_event *ev;
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+		for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len)
+		{
+			ev = (struct inotify_event*)p;
+			if (ev->len && !strcmp(ev->name, settings_name)) hit = 1;
+		}
+	if (hit) settings_reload();
+}
+
+void settings_load()
+{
+	char *home = getenv("HOME"), *slash;
+	settings_defaults(&settings);
+	if (!CONFIG_FILE || !home) return;
+
+	snprintf(settings_path, sizeof(settings_path), "%s/%s", home, CONFIG_FILE);
+	settings_read(&settings, settings_keys, &nsettings_keys);
+
+	slash = strrchr(settings_path, '/');
+	settings_name = slash+1;
+	if ((settings_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) < 0) return;
+	*slash = 0;
+	inotify_add_watch(settings_fd, settings_path, IN_CLOSE_WRITE|IN_MOVED_TO|IN_DELETE);
+	*slash = '/';
+	loop_watch(settings_fd, settings_changed);
+}
@@ -29,12 +29,49 @@ typedef struct {
 	long left, right, top, bottom, ly1, ly2, ry1, ry3, tx1, tx2, bx1, bx2;
 } wm_strut;
 
+#define STARTUP_PHASES 8
+
+struct {
+	const char *name;
+	long long usec;
+} startup_phases[STARTUP_PHASES];
+
+int startup_count;
+long long startup_mark;
+
+// time since the last phase mark. NULL just sets the mark.
+void startup_phase(const char *name)
+{
+	long long now = usec();
+	if (name && startup_count < STARTUP_PHASES)
+	{
+		startup_phases[startup_count].name = name;
+		startup_phases[startup_count++].usec = now - startup_mark;
+	}
+	startup_mark = now;
+}
+
+void startup_report()
+{
+	char buf[512]; int i, len = 0; long long total = 0;
+	if (!STARTUP_REPORT) return;
+	for (i = 0; i < startup_count; i++)
+	{
+		total += startup_phases[i].usec;
+		len += snprintf(buf+len, MAX(0, (int)sizeof(buf)-len), " %s=%lldus", startup_phases[i].name, startup_phases[i].usec);
+	}
+	warnx("startup %lldus:%s", total, buf);
+}
+
 void setup()
 {
 	int i, j; client *c; monitor *m;
 	int screen_w = WidthOfScreen(DefaultScreenOfDisplay(display));
 	int screen_h = HeightOfScreen(DefaultScreenOfDisplay(display));
 
+	// config.h values, overridden by the config file if there is one
+	settings_load();
+
 	// default non-multi-head setup
 	monitors[0].w = screen_w;
 	monitors[0].h = screen_h;
@@ -59,12 +96,13 @@ void setup()
 	memmove(padded, monitors, sizeof(monitor) * MONITORS);
 	wm_strut all_struts; memset(&all_struts, 0, sizeof(wm_strut));
 
-	for_windows(i, c)
+	// hidden windows reserve nothing, so skip their property reads
+	for_windows(i, c) if (c->visible)
 	{
 		wm_strut strut; memset(&strut, 0, sizeof(wm_strut));
 		int v2 = GETPROP_LONG(c->window, atoms[_NET_WM_STRUT_PARTIAL], (unsigned long*)&strut, 12);
 		int v1 = v2 ? 0: GETPROP_LONG(c->window, atoms[_NET_WM_STRUT], (unsigned long*)&strut, 4);
-		if (!c->visible || (!v1 && !v2)) continue;
+		if (!v1 && !v2) continue;
 
 		all_struts.left   = MAX(all_struts.left,   strut.left);
 		all_struts.right  = MAX(all_struts.right,  strut.right);
@@ -100,54 +138,19 @@ void setup()
 		}
 	}
 	memmove(monitors, padded, sizeof(monitor) * MONITORS);
+	startup_phase("screens");
 
-	// calculate spot boxes
-	for_monitors(i, m)
-	{
-		int x = m->x, y = m->y, w = m->w, h = m->h;
-		// monitor rotated?
-		if (m->w < m->h)
-		{
-			int height_spot1 = (double)h / 100 * MIN(90, MAX(10, SPOT1_WIDTH_PCT));
-			int width_spot2  = (double)w / 100 * MIN(90, MAX(10, SPOT2_HEIGHT_PCT));
-			for_spots(j)
-			{
-				m->spots[j].x = x;
-				m->spots[j].y = SPOT1_ALIGN == SPOT1_LEFT ? y: y + h - height_spot1;
-				m->spots[j].w = w;
-				m->spots[j].h = height_spot1;
-				if (j == SPOT1) continue;
-
-				m->spots[j].y = SPOT1_ALIGN == SPOT1_LEFT ? y + height_spot1 + GAP: y;
-				m->spots[j].h = h - height_spot1 - GAP;
-				m->spots[j].w = w - width_spot2 - GAP;
-				if (j == SPOT3) continue;
-
-				m->spots[j].x = x + w - width_spot2;
-				m->spots[j].w = width_spot2;
-			}
-			continue;
-		}
-		// normal wide screen
-		int width_spot1  = (double)w / 100 * MIN(90, MAX(10, SPOT1_WIDTH_PCT));
-		int height_spot2 = (double)h / 100 * MIN(90, MAX(10, SPOT2_HEIGHT_PCT));
-		for_spots(j)
-		{
-			m->spots[j].x = SPOT1_ALIGN == SPOT1_LEFT ? x: x + w - width_spot1;
-			m->spots[j].y = y;
-			m->spots[j].w = width_spot1;
-			m->spots[j].h = h;
-			if (j == SPOT1) continue;
-
-			m->spots[j].x = SPOT1_ALIGN == SPOT1_LEFT ? x + width_spot1 + GAP: x;
-			m->spots[j].w = w - width_spot1 - GAP;
-			m->spots[j].h = height_spot2;
-			if (j == SPOT2) continue;
-
-			m->spots[j].y = y + height_spot2 + GAP;
-			m->spots[j].h = h - height_spot2 - GAP;
-		}
-	}
+	spot_layout();
+
+	// signals, timers and child processes
+	trace_open();
+	render_init();
+	loop_init();
+	launch_prepare();
+	path_init();
+
+	// per-class placement memory
+	places_open();
 
 	// become the window manager
 	XSelectInput(display, root, StructureNotifyMask | SubstructureRedirectMask | SubstructureNotifyMask);
@@ -164,49 +167,62 @@ void setup()
 
 	// figure out NumlockMask
 	XModifierKeymap *modmap = XGetModifierMapping(display);
+	KeyCode numlock = XKeysymToKeycode(display, XK_Num_Lock);
 	for (i = 0; i < 8; i++) for (j = 0; j < (int)modmap->max_keypermod; j++)
-		if (modmap->modifiermap[i*modmap->max_keypermod+j] == XKeysymToKeycode(display, XK_Num_Lock))
+		if (modmap->modifiermap[i*modmap->max_keypermod+j] == numlock)
 			{ NumlockMask = (1<<i); break; }
 	XFreeModifiermap(modmap);
 
-	// process config.h key bindings
+	// process config.h and config file key bindings. grabs are async; they
+	// go out in one batch
 	for (i = 0; i < sizeof(keys)/sizeof(binding); i++)
-	{
-		XGrabKey(display, XKeysymToKeycode(display, keys[i].key), keys[i].mod, root, True, GrabModeAsync, GrabModeAsync);
-		if (keys[i].mod == AnyModifier) continue;
+		key_grab(&keys[i], 1);
+	for (i = 0; i < nsettings_keys; i++)
+		key_grab(&settings_keys[i], 1);
 
-		XGrabKey(display, XKeysymToKeycode(display, keys[i].key), keys[i].mod|LockMask, root, True, GrabModeAsync, GrabModeAsync);
-		XGrabKey(display, XKeysymToKeycode(display, keys[i].key), keys[i].mod|NumlockMask, root, True, GrabModeAsync, GrabModeAsync);
-		XGrabKey(display, XKeysymToKeycode(display, keys[i].key), keys[i].mod|LockMask|NumlockMask, root, True, GrabModeAsync, GrabModeAsync);
-	}
-
-	// we grab buttons to do click-to-focus. all clicks get passed through to apps.
-	XGrabButton(display, Button1, AnyModifier, root, True, ButtonPressMask, GrabModeSync, GrabModeSync, None, None);
-	XGrabButton(display, Button3, AnyModifier, root, True, ButtonPressMask, GrabModeSync, GrabModeSync, None, None);
+	pixel_focus  = color_pixel(settings.border_focus);
+	pixel_blur   = color_pixel(settings.border_blur);
+	pixel_urgent = color_pixel(settings.border_urgent);
+	startup_phase("ewmh+grabs");
 
-	// create title bars
+	// create title bars. they're drawn once everything is placed
 	if (TITLE)
 	{
-		STACK_FREE(&windows);
 		for_monitors(i, m) for_spots(j)
 		{
 			m->bars[j] = textbox_create(root, TB_AUTOHEIGHT|TB_LEFT, m->spots[j].x, m->spots[j].y, m->spots[j].w, 0,
-				TITLE, TITLE_BLUR, BORDER_BLUR, NULL, NULL);
-			XSelectInput(display, m->bars[j]->window, ExposureMask);
-
-			m->spots[j].y += m->bars[j]->h;
-			m->spots[j].h -= m->bars[j]->h;
-			spot_update_bar(j, i);
+				settings.title, settings.title_blur, settings.border_blur, NULL, NULL);
+			XSelectInput(display, m->bars[j]->window, ExposureMask | ButtonPressMask);
 		}
+		// make room for them
+		spot_layout();
 	}
+	startup_phase("bars");
 
-	// setup existing managable windows
+	// setup existing managable windows. spots have moved, so rescan once
 	STACK_FREE(&windows);
+	arena_reset();
+	client *first = NULL;
 	for_windows(i, c) if (c->manage)
 	{
 		window_listen(c->window);
 		client_update_border(c);
 		client_place_spot(c, c->spot, c->monitor, 0);
-		if (!current) client_activate(c);
+		if (!first) first = c;
 	}
+	client_activate(first);
+	defer_bars();
+
+	// mapping order is unknown for existing windows; use bottom to top
+	ewmh_client_reset();
+	for_windows_rev(i, c) if (c->manage)
+		ewmh_client_add(c->window);
+	defer(DEFER_CLIENT_LIST);
+	defer_flush();
+	startup_phase("adopt");
+
+	TRACE_SYNC("XSync");
+	XSync(display, False);
+	startup_phase("sync");
+	startup_report();
 }
@@ -0,0 +1,135 @@
+#!/bin/sh
+# Soak test: run xoat on a private Xvfb, hammer it with client storms and
+# fail if its RSS, open fds, live heap blocks or X server resources keep
+# growing once the warmup rounds are over. Then leave it idle for IDLE
+# seconds and fail if its event loop woke up more than IDLE_SLACK times.
+#
+#   make soak
+#   ROUNDS=200 COUNT=100 sh soak/soak.sh
+#   ROUNDS=1 WARMUP=0 IDLE=300 sh soak/soak.sh    # idle wakeups only
+#
+# Needs Xvfb. XRes totals are sampled with xrestop when it is installed.
+# Exits 0 when flat, 1 on growth or if xoat dies, 2 if it cannot run.
+
+ROUNDS=${ROUNDS:-50}
+WARMUP=${WARMUP:-5}
+COUNT=${COUNT:-50}
+SCREEN=${SCREEN:-:87}
+RSS_SLACK=${RSS_SLACK:-1024}
+FD_SLACK=${FD_SLACK:-0}
+HEAP_SLACK=${HEAP_SLACK:-256}
+RES_SLACK=${RES_SLACK:-0}
+IDLE=${IDLE:-30}
+IDLE_SLACK=${IDLE_SLACK:-2}
+
+cd "$(dirname "$0")/.." || exit 2
+for f in ./xoat ./soak/storm; do
+	[ -x "$f" ] || { echo "soak: $f not built, run make soak" >&2; exit 2; }
+done
+command -v Xvfb >/dev/null || { echo "soak: Xvfb not found" >&2; exit 2; }
+
+tmp=$(mktemp -d) || exit 2
+xvfb= wm=
+cleanup()
+{
+	[ -n "$wm" ] && kill "$wm" 2>/dev/null
+	[ -n "$xvfb" ] && kill "$xvfb" 2>/dev/null
+	wait 2>/dev/null
+	rm -rf "$tmp"
+}
+trap cleanup EXIT
+trap 'exit 2' INT TERM
+
+export DISPLAY=$SCREEN
+Xvfb "$SCREEN" -screen 0 1280x1024x24 -nolisten tcp >"$tmp/xvfb.log" 2>&1 &
+xvfb=$!
+i=0
+until ./soak/storm ping 2>/dev/null; do
+	i=$((i+1))
+	[ $i -gt 50 ] && { echo "soak: Xvfb did not start" >&2; cat "$tmp/xvfb.log" >&2; exit 2; }
+	sleep 0.1
+done
+
+HOME=$tmp ./xoat >"$tmp/xoat.log" 2>&1 &
+wm=$!
+i=0
+until ./xoat stats >/dev/null 2>&1; do
+	i=$((i+1))
+	[ $i -gt 50 ] && { echo "soak: xoat did not start" >&2; cat "$tmp/xoat.log" >&2; exit 2; }
+	sleep 0.1
+done
+
+wakeups()
+{
+	./xoat stats 2>/dev/null | sed -n 's/^loop: wakeups=\([0-9]*\).*/\1/p'
+}
+
+# sample: sets rss fds heap res from xoat stats and xrestop
+sample()
+{
+	./xoat stats >"$tmp/stats" 2>/dev/null || return 1
+	rss=$(sed -n 's/^process: rss=\([0-9]*\)kB.*/\1/p' "$tmp/stats")
+	fds=$(sed -n 's/^process: .* fds=\([0-9]*\).*/\1/p' "$tmp/stats")
+	heap=$(sed -n 's/^heap: allocs=\([0-9]*\) frees=\([0-9]*\).*/\1 \2/p' "$tmp/stats" | awk '{ print $1 - $2 }')
+	res=0
+	if command -v xrestop >/dev/null; then
+		res=$(xrestop -b -m 1 2>/dev/null | awk -v pid="$wm" '
+			/PID:/ { mine = ($0 ~ "PID: *" pid "[^0-9]") }
+			mine && /^[ \t]*(windows|GCs|fonts|pixmaps|pictures|glyphsets|colormaps|passive grabs|cursors|other)[ \t]*:/ {
+				sub(/.*:/, ""); total += $1
+			}
+			END { print total + 0 }')
+	fi
+	: "${heap:=0}"
+}
+
+round=0
+while [ $round -lt "$ROUNDS" ]; do
+	./soak/storm all "$COUNT" || { echo "soak: storm failed in round $round" >&2; exit 1; }
+	kill -0 "$wm" 2>/dev/null || { echo "soak: xoat died in round $round" >&2; cat "$tmp/xoat.log" >&2; exit 1; }
+	sample || { echo "soak: no stats in round $round" >&2; exit 1; }
+	if [ $round -eq "$WARMUP" ]; then
+		rss0=$rss fds0=$fds heap0=$heap res0=$res
+	fi
+	echo "round $round: rss=${rss}kB fds=$fds heap=$heap xres=$res"
+	round=$((round+1))
+done
+
+[ -n "$rss0" ] || { echo "soak: ROUNDS must exceed WARMUP" >&2; exit 2; }
+
+status=0
+grew()
+{
+	if [ "$3" -gt $(($2 + $4)) ]; then
+		echo "soak: $1 grew from $2 to $3 (slack $4)" >&2
+		status=1
+	fi
+}
+grew rss "$rss0" "$rss" "$RSS_SLACK"
+grew fds "$fds0" "$fds" "$FD_SLACK"
+grew heap "$heap0" "$heap" "$HEAP_SLACK"
+grew xres "$res0" "$res" "$RES_SLACK"
+
+[ $status -eq 0 ] && echo "soak: flat after $ROUNDS rounds"
+
+# each stats request wakes the loop itself, so measure that cost with two
+# back to back requests and expect nothing else while idle
+if [ "$IDLE" -gt 0 ]; then
+	sleep 2
+	w0=$(wakeups) w1=$(wakeups)
+	sleep "$IDLE"
+	w2=$(wakeups)
+	if [ -z "$w0" ] || [ -z "$w1" ] || [ -z "$w2" ]; then
+		echo "soak: no loop stats while idle" >&2
+		status=1
+	else
+		idle=$((w2 - w1 - (w1 - w0)))
+		echo "idle ${IDLE}s: wakeups=$idle"
+		if [ $idle -gt "$IDLE_SLACK" ]; then
+			echo "soak: $idle wakeups in ${IDLE}s idle (slack $IDLE_SLACK)" >&2
+			status=1
+		fi
+	fi
+fi
+
+exit $status
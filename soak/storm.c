@@ -0,0 +1,173 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Client storms for the soak test. Each run opens a connection, does one
+// round of the named storm against whatever window manager is running,
+// then cleans up and exits:
+//
+//   storm maps N     map N windows, retitle them, unmap and destroy them
+//   storm titles N   retitle a few mapped windows N times each
+//   storm popups N   map and unmap N override-redirect windows
+//   storm dialogs N  map N transient dialogs over one parent
+//   storm all N      each of the above
+//   storm ping       exit 0 once the display accepts a connection
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TITLED 4
+
+Display *display;
+Window root;
+Atom net_wm_name, utf8_string;
+unsigned long serial;
+
+Window storm_window(int override)
+{
+	XSetWindowAttributes attr; attr.override_redirect = override ? True: False;
+	Window w = XCreateWindow(display, root, rand() % 800, rand() % 600, 100 + rand() % 600, 100 + rand() % 400, 0,
+		CopyFromParent, InputOutput, CopyFromParent, CWOverrideRedirect, &attr);
+	XClassHint hint = { "storm", rand() % 2 ? "Storm": "Squall" };
+	XSetClassHint(display, w, &hint);
+	return w;
+}
+
+// alternate plain and multi-byte titles of varying length, so bars miss
+// the pixmap cache and glyph caches see new characters
+void storm_title(Window w)
+{
+	char title[256]; unsigned long s = serial++;
+	int n = snprintf(title, sizeof(title), "storm %lu %s", s,
+		s % 3 == 0 ? "\xe6\x9a\xb4\xe9\xa2\xa8\xe9\x9b\xa8": s % 3 == 1 ? "\xd0\xb1\xd1\x83\xd1\x80\xd1\x8f": "tempest");
+	for (int i = rand() % 8; i > 0 && n < sizeof(title)-2; i--) title[n++] = 'a' + rand() % 26;
+	title[n] = 0;
+	XStoreName(display, w, title);
+	XChangeProperty(display, w, net_wm_name, utf8_string, 8, PropModeReplace, (unsigned char*)title, n);
+}
+
+void storm_maps(int count)
+{
+	Window *ws = calloc(count, sizeof(Window));
+	for (int i = 0; i < count; i++)
+	{
+		ws[i] = storm_window(0);
+		storm_title(ws[i]);
+		XMapWindow(display, ws[i]);
+	}
+	XSync(display, False);
+	for (int i = 0; i < count; i++) storm_title(ws[i]);
+	XSync(display, False);
+	for (int i = 0; i < count; i++)
+	{
+		if (i % 2) XUnmapWindow(display, ws[i]);
+		XDestroyWindow(display, ws[i]);
+	}
+	XSync(display, False);
+	free(ws);
+}
+
+void storm_titles(int count)
+{
+	Window ws[TITLED]; int i, j;
+	for (i = 0; i < TITLED; i++)
+	{
+		ws[i] = storm_window(0);
+		storm_title(ws[i]);
+		XMapWindow(display, ws[i]);
+	}
+	XSync(display, False);
+	for (j = 0; j < count; j++)
+	{
+		for (i = 0; i < TITLED; i++) storm_title(ws[i]);
+		if (j % 16 == 0) XSync(display, False);
+	}
+	for (i = 0; i < TITLED; i++) XDestroyWindow(display, ws[i]);
+	XSync(display, False);
+}
+
+void storm_popups(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		Window w = storm_window(1);
+		XMapWindow(display, w);
+		XUnmapWindow(display, w);
+		XDestroyWindow(display, w);
+	}
+	XSync(display, False);
+}
+
+void storm_dialogs(int count)
+{
+	Window parent = storm_window(0), *ws = calloc(count, sizeof(Window));
+	storm_title(parent);
+	XMapWindow(display, parent);
+	for (int i = 0; i < count; i++)
+	{
+		ws[i] = storm_window(0);
+		XSetTransientForHint(display, ws[i], parent);
+		storm_title(ws[i]);
+		XMapWindow(display, ws[i]);
+	}
+	XSync(display, False);
+	for (int i = 0; i < count; i++) XDestroyWindow(display, ws[i]);
+	XDestroyWindow(display, parent);
+	XSync(display, False);
+	free(ws);
+}
+
+int main(int argc, char *argv[])
+{
+	int count = argc > 2 ? atoi(argv[2]): 50;
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: storm maps|titles|popups|dialogs|all|ping [count]\n");
+		return 2;
+	}
+	if (!(display = XOpenDisplay(NULL)))
+		return 1;
+	if (!strcmp(argv[1], "ping"))
+		return 0;
+
+	root = DefaultRootWindow(display);
+	net_wm_name = XInternAtom(display, "_NET_WM_NAME", False);
+	utf8_string = XInternAtom(display, "UTF8_STRING", False);
+	srand(getpid());
+
+	int all = !strcmp(argv[1], "all");
+	if (all || !strcmp(argv[1], "maps"))    storm_maps(count);
+	if (all || !strcmp(argv[1], "titles"))  storm_titles(count);
+	if (all || !strcmp(argv[1], "popups"))  storm_popups(count);
+	if (all || !strcmp(argv[1], "dialogs")) storm_dialogs(count);
+
+	XCloseDisplay(display);
+	return 0;
+}
@@ -24,56 +24,134 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
-#define SPOT_BUFF 1024
+// composed bar text, grown as needed
+char *spot_buff;
+int spot_size;
 
-void spot_update_bar(int spot, int mon)
+void spot_buff_reserve(int need)
 {
-	int i, n = 0, len = 0; client *o, *c = NULL;
-	char title[SPOT_BUFF]; *title = 0;
-	monitor *m = &monitors[mon];
+	if (need > spot_size)
+	{
+		spot_size = MAX(need, spot_size*2);
+		spot_buff = realloc(spot_buff, spot_size);
+	}
+}
 
-	for_windows(i, o) if (o->manage && o->spot == spot && o->monitor == mon)
+void spot_buff_append(int *len, int n, char *name, XftFont *font)
+{
+	int nlen = strlen(name), fit = nlen;
+	spot_buff_reserve(*len + nlen + 32);
+	if (TITLE_ELLIPSIS > 0)
+		fit = textbox_ellipsize(font, name, nlen, TITLE_ELLIPSIS);
+	if (fit < nlen)
+		*len += sprintf(spot_buff+*len, " [%d] %.*s...  ", n, fit, name);
+	else
+		*len += sprintf(spot_buff+*len, " [%d] %s  ", n, name);
+}
+
+// calculate spot boxes from the monitor boxes and the layout settings,
+// leaving room for title bars once they exist
+void spot_layout()
+{
+	int i, j; monitor *m;
+	for_monitors(i, m)
 	{
-		if (!c) c = o;
-		char *name = NULL, *tmp = NULL;
-		if (!(name = window_get_text_prop(o->window, atoms[_NET_WM_NAME])))
-			if (XFetchName(display, o->window, &tmp))
-				name = strdup(tmp);
-		if (name)
+		int x = m->x, y = m->y, w = m->w, h = m->h;
+		// monitor rotated?
+		if (m->w < m->h)
 		{
-			if (TITLE_ELLIPSIS > 0 && strlen(name) > TITLE_ELLIPSIS)
+			int height_spot1 = (double)h / 100 * MIN(90, MAX(10, settings.spot1_width_pct));
+			int width_spot2  = (double)w / 100 * MIN(90, MAX(10, settings.spot2_height_pct));
+			for_spots(j)
 			{
-				name = realloc(name, strlen(name)+4);
-				strcpy(name+TITLE_ELLIPSIS, "...");
+				m->spots[j].x = x;
+				m->spots[j].y = SPOT1_ALIGN == SPOT1_LEFT ? y: y + h - height_spot1;
+				m->spots[j].w = w;
+				m->spots[j].h = height_spot1;
+				if (j == SPOT1) continue;
+
+				m->spots[j].y = SPOT1_ALIGN == SPOT1_LEFT ? y + height_spot1 + settings.gap: y;
+				m->spots[j].h = h - height_spot1 - settings.gap;
+				m->spots[j].w = w - width_spot2 - settings.gap;
+				if (j == SPOT3) continue;
+
+				m->spots[j].x = x + w - width_spot2;
+				m->spots[j].w = width_spot2;
 			}
-			len += snprintf(title+len, MAX(0, SPOT_BUFF-len), " [%d] %s  ", n++, name);
-			free(name);
+			continue;
 		}
-		if (tmp) XFree(tmp);
-	}
-	if (TITLE)
-	{
-		if (c && !c->full && *title && m->bars[spot])
+		// normal wide screen
+		int width_spot1  = (double)w / 100 * MIN(90, MAX(10, settings.spot1_width_pct));
+		int height_spot2 = (double)h / 100 * MIN(90, MAX(10, settings.spot2_height_pct));
+		for_spots(j)
 		{
-			int focus = c->window == current || (spot == current_spot && mon == current_mon);
-			char *color  = focus && c->window == current ? TITLE_FOCUS : TITLE_BLUR;
-			char *border = focus && c->window == current ? BORDER_FOCUS: BORDER_BLUR;
-			textbox_font(m->bars[spot], TITLE, color, border);
-			textbox_text(m->bars[spot], title);
-			textbox_draw(m->bars[spot]);
-			textbox_show(m->bars[spot]);
+			m->spots[j].x = SPOT1_ALIGN == SPOT1_LEFT ? x: x + w - width_spot1;
+			m->spots[j].y = y;
+			m->spots[j].w = width_spot1;
+			m->spots[j].h = h;
+			if (j == SPOT1) continue;
+
+			m->spots[j].x = SPOT1_ALIGN == SPOT1_LEFT ? x + width_spot1 + settings.gap: x;
+			m->spots[j].w = w - width_spot1 - settings.gap;
+			m->spots[j].h = height_spot2;
+			if (j == SPOT2) continue;
+
+			m->spots[j].y = y + height_spot2 + settings.gap;
+			m->spots[j].h = h - height_spot2 - settings.gap;
 		}
-		else
-		if (m->bars[spot])
-			textbox_hide(m->bars[spot]);
+	}
+
+	if (TITLE) for_monitors(i, m) for_spots(j) if (m->bars[j])
+	{
+		textbox_moveresize(m->bars[j], m->spots[j].x, m->spots[j].y, m->spots[j].w, 0);
+		m->spots[j].y += m->bars[j]->h;
+		m->spots[j].h -= m->bars[j]->h;
 	}
 }
 
-void update_bars()
+// on the render thread when there is one
+void spot_draw_bar(int spot, int mon)
 {
-	int i, j; monitor *m;
-	if (TITLE) for_monitors(i, m) for_spots(j)
-		spot_update_bar(j, i);
+	monitor *m = &monitors[mon];
+	if (!render_push(m->bars[spot], mon * (SPOT3+1) + spot))
+		textbox_draw(m->bars[spot]);
+}
+
+void spot_update_bar(int spot, int mon)
+{
+	int i, n = 0, len = 0, state = 0; client *o, *c = NULL; char *name;
+	monitor *m = &monitors[mon];
+	textbox *bar = m->bars[spot];
+	if (!TITLE || !bar) return;
+	TRACE("call", "spot_update_bar");
+
+	// titles come from the cache; no server round trips here
+	spot_buff_reserve(1);
+	*spot_buff = 0;
+	for_windows(i, o) if (o->manage && o->spot == spot && o->monitor == mon)
+	{
+		if (!c) c = o;
+		if ((name = cache_title(o->window)))
+			spot_buff_append(&len, n++, name, bar->font);
+	}
+	if (c && !c->full && len)
+		state = c->window == current ? 2: 1;
+
+	// nothing changed since the last draw
+	if (state == m->bar_state[spot] && (!state || !strcmp(bar->text, spot_buff)))
+		return;
+	m->bar_state[spot] = state;
+
+	if (state)
+	{
+		textbox_font(bar, settings.title, state == 2 ? settings.title_focus: settings.title_blur,
+			state == 2 ? settings.border_focus: settings.border_blur);
+		textbox_text(bar, spot_buff);
+		spot_draw_bar(spot, mon);
+		textbox_show(bar);
+	}
+	else
+		textbox_hide(bar);
 }
 
 Window spot_focus_top_window(int spot, int mon, Window except)
@@ -96,7 +174,8 @@ Window spot_try_focus_top_window(int spot, int mon, Window except)
 		current      = None;
 		current_mon  = mon;
 		current_spot = spot;
-		update_bars();
+		client_free_buttons(None);
+		defer_bars();
 
 		XSetInputFocus(display, PointerRoot, RevertToPointerRoot, CurrentTime);
 	}
@@ -0,0 +1,173 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// `xoat stats` asks the running instance for its counters. They're written
+// as text to the XOAT_STATS property on the root window.
+
+#define STATS_BUFF 8192
+
+char stats_buf[STATS_BUFF];
+int stats_len;
+
+struct {
+	unsigned long seen, dropped, handled;
+} event_stats[LASTEvent];
+
+// deepest the Xlib event queue got; how far behind the server we fell
+int event_backlog;
+
+// bound key presses, the runs they were grouped into, and what actually ran
+struct {
+	unsigned long presses, runs, actions;
+} key_stats;
+
+const char *event_names[LASTEvent] = {
+	[KeyPress]         = "KeyPress",
+	[ButtonPress]      = "ButtonPress",
+	[EnterNotify]      = "EnterNotify",
+	[LeaveNotify]      = "LeaveNotify",
+	[FocusIn]          = "FocusIn",
+	[FocusOut]         = "FocusOut",
+	[Expose]           = "Expose",
+	[CreateNotify]     = "CreateNotify",
+	[DestroyNotify]    = "DestroyNotify",
+	[UnmapNotify]      = "UnmapNotify",
+	[MapNotify]        = "MapNotify",
+	[MapRequest]       = "MapRequest",
+	[ReparentNotify]   = "ReparentNotify",
+	[ConfigureNotify]  = "ConfigureNotify",
+	[ConfigureRequest] = "ConfigureRequest",
+	[PropertyNotify]   = "PropertyNotify",
+	[ClientMessage]    = "ClientMessage",
+};
+
+void stats_printf(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	stats_len += vsnprintf(stats_buf+stats_len, MAX(0, STATS_BUFF-stats_len), fmt, ap);
+	stats_len = MIN(stats_len, STATS_BUFF-1);
+	va_end(ap);
+}
+
+// resident set and open descriptors, to spot slow growth over a long session
+void stats_process()
+{
+	long pages = 0, rss = 0; int fds = 0; DIR *d; struct dirent *de;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f)
+	{
+		if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0;
+		fclose(f);
+	}
+	if ((d = opendir("/proc/self/fd")))
+	{
+		while ((de = readdir(d))) if (de->d_name[0] != '.') fds++;
+		closedir(d);
+		fds--; // the one opendir holds
+	}
+	stats_printf("process: rss=%ldkB fds=%d backlog_max=%d\n",
+		rss * (sysconf(_SC_PAGESIZE) / 1024), fds, event_backlog);
+}
+
+void stats_publish()
+{
+	stats_len = 0; *stats_buf = 0;
+
+	stats_printf("launch: spawned=%lu failed=%lu shell=%lu reaped=%lu spawn_avg=%lldus spawn_max=%lldus\n",
+		launches.spawned, launches.failed, launches.shell, launches.reaped,
+		launches.spawned ? launches.spawn_usec / (long long)launches.spawned: 0, launches.spawn_max);
+
+	stats_printf("arena: allocs=%lu high=%zu/%d overflows=%lu interned=%lu\n",
+		arena_stats.allocs, arena_stats.high, ARENA, arena_stats.overflows, arena_stats.interned);
+#ifdef __GLIBC__
+	stats_printf("heap: allocs=%lu frees=%lu\n", __atomic_load_n(&heap_stats.allocs, __ATOMIC_RELAXED),
+		__atomic_load_n(&heap_stats.frees, __ATOMIC_RELAXED));
+#endif
+
+	stats_process();
+
+	stats_printf("prefetch: stored=%lu used=%lu missed=%lu refreshed=%lu\n",
+		prefetch_stats.stored, prefetch_stats.used, prefetch_stats.missed, prefetch_stats.refreshed);
+
+	stats_printf("admit: windows=%lu avg=%lldus max=%lldus\n", admissions.windows,
+		admissions.windows ? admissions.usec / (long long)admissions.windows: 0, admissions.max);
+
+	stats_printf("keys: presses=%lu runs=%lu actions=%lu\n",
+		key_stats.presses, key_stats.runs, key_stats.actions);
+
+	stats_printf("render: queued=%lu drawn=%lu skipped=%lu inline=%lu\n", render_stats.queued,
+		__atomic_load_n(&render_stats.drawn, __ATOMIC_RELAXED), __atomic_load_n(&render_stats.skipped, __ATOMIC_RELAXED),
+		render_stats.inline_draws);
+
+	pthread_mutex_lock(&pixmap_mutex);
+	stats_printf("pixmaps: hits=%lu misses=%lu evictions=%lu bytes=%zu/%d\n", pixmap_stats.hits,
+		pixmap_stats.misses, pixmap_stats.evictions, pixmap_stats.bytes, PIXMAP_BYTES * (render_display ? 2: 1));
+	pthread_mutex_unlock(&pixmap_mutex);
+
+	stats_printf("loop: wakeups=%lu signals=%lu timers=%lu\n",
+		loop_stats.wakeups, loop_stats.signals, loop_stats.timers);
+
+	for (int i = 0; i < CACHE; i++) if (cache[i].window && cache[i].title_updates)
+		stats_printf("title 0x%lx: updates=%lu throttled=%lu %.40s\n", cache[i].window,
+			cache[i].title_updates, cache[i].title_throttled, cache[i].title);
+
+	for (int i = 0; i < LASTEvent; i++) if (event_stats[i].seen)
+	{
+		if (event_names[i]) stats_printf("event %s:", event_names[i]);
+		else stats_printf("event %d:", i);
+		stats_printf(" seen=%lu dropped=%lu handled=%lu\n",
+			event_stats[i].seen, event_stats[i].dropped, event_stats[i].handled);
+	}
+
+	XChangeProperty(display, root, atoms[XOAT_STATS], XA_STRING, 8, PropModeReplace, (unsigned char*)stats_buf, stats_len);
+}
+
+// client side of `xoat stats`: wait briefly for the property to change
+void stats_request(Window cli)
+{
+	struct pollfd pfd = { .fd = ConnectionNumber(display), .events = POLLIN };
+	XEvent ev; char *text; long long until = usec() + 1000000;
+
+	XSelectInput(display, root, PropertyChangeMask);
+	window_send_clientmessage(root, cli, atoms[XOAT_STATS], 0, SubstructureNotifyMask | SubstructureRedirectMask);
+
+	while (usec() < until)
+	{
+		while (XPending(display))
+		{
+			XNextEvent(display, &ev);
+			if (ev.type == PropertyNotify && ev.xproperty.atom == atoms[XOAT_STATS])
+			{
+				if ((text = window_get_text_prop(root, atoms[XOAT_STATS])))
+					fputs(text, stdout);
+				return;
+			}
+		}
+		poll(&pfd, 1, 100);
+	}
+	errx(EXIT_FAILURE, "no reply from xoat");
+}
@@ -35,14 +35,127 @@ typedef struct {
 	unsigned long flags;
 	Window window, parent;
 	short x, y, w, h, cursor;
+	int size;
 	XftFont *font;
 	XftColor color_fg, color_bg;
-	char *text, *prompt;
+	char *text, *prompt, *font_name, *fg_name, *bg_name;
 	XIM xim;
 	XIC xic;
 	XGlyphInfo extents;
 } textbox;
 
+// Glyph advances per font, filled lazily from Xft. Measuring a string is
+// then a walk over its UTF-8 with no server work and no temporary copies.
+
+#define GLYPH_FONTS 4
+#define GLYPHS 512
+#define GLYPH_PROBE 8
+
+typedef struct {
+	XftFont *font;
+	int height, max_advance;
+	short ascii[128];
+	FcChar32 chars[GLYPHS];
+	short advances[GLYPHS];
+} glyph_cache;
+
+glyph_cache glyph_caches[GLYPH_FONTS];
+int glyph_next;
+
+// Xft is not thread safe: its per-display list, fontconfig and the FreeType
+// faces behind fonts are process wide, and the title bar render thread uses
+// them too. Each thread has its own fonts and colors and takes the mutex
+// only around the Xft calls themselves, never for a whole bar
+pthread_mutex_t xft_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+glyph_cache* glyph_cache_get(XftFont *font)
+{
+	int i; glyph_cache *g;
+	// fonts are matched on more than the pointer, in case Xft recycled it
+	for (i = 0; i < GLYPH_FONTS; i++)
+	{
+		g = &glyph_caches[i];
+		if (g->font == font && g->height == font->height && g->max_advance == font->max_advance_width)
+			return g;
+	}
+	g = &glyph_caches[glyph_next++ % GLYPH_FONTS];
+	memset(g, 0, sizeof(glyph_cache));
+	memset(g->ascii, 0xff, sizeof(g->ascii));
+	g->font = font;
+	g->height = font->height;
+	g->max_advance = font->max_advance_width;
+	return g;
+}
+
+int glyph_advance(glyph_cache *g, FcChar32 ch)
+{
+	int i, slot = -1; XGlyphInfo info; FT_UInt glyph;
+	if (ch < 128 && g->ascii[ch] >= 0)
+		return g->ascii[ch];
+	if (ch >= 128)
+	{
+		for (i = 0; i < GLYPH_PROBE; i++)
+		{
+			slot = (ch + i) % GLYPHS;
+			if (g->chars[slot] == ch) return g->advances[slot];
+			if (!g->chars[slot]) break;
+		}
+		if (g->chars[slot]) slot = ch % GLYPHS;
+	}
+	pthread_mutex_lock(&xft_mutex);
+	glyph = XftCharIndex(display, g->font, ch);
+	XftGlyphExtents(display, g->font, &glyph, 1, &info);
+	pthread_mutex_unlock(&xft_mutex);
+	if (ch < 128)
+		g->ascii[ch] = info.xOff;
+	else
+	{
+		g->chars[slot] = ch;
+		g->advances[slot] = info.xOff;
+	}
+	return info.xOff;
+}
+
+// decode one UTF-8 character. invalid bytes are measured as '?'
+int utf8_next(const char *str, int len, FcChar32 *ch)
+{
+	int n = FcUtf8ToUcs4((const FcChar8*)str, ch, len);
+	if (n > 0) return n;
+	*ch = '?';
+	return 1;
+}
+
+// pixel width of len bytes of str
+int textbox_measure(XftFont *font, const char *str, int len)
+{
+	int i = 0, width = 0; FcChar32 ch;
+	glyph_cache *g = glyph_cache_get(font);
+	while (i < len)
+	{
+		i += utf8_next(str+i, len-i, &ch);
+		width += glyph_advance(g, ch);
+	}
+	return width;
+}
+
+// how many bytes of str fit in width pixels. if the whole string does not
+// fit, the cut leaves room for "..." and never splits a character
+int textbox_ellipsize(XftFont *font, const char *str, int len, int width)
+{
+	int i = 0, n, w = 0, cut = 0; FcChar32 ch;
+	glyph_cache *g = glyph_cache_get(font);
+	int room = width - glyph_advance(g, '.') * 3;
+	while (i < len)
+	{
+		n = utf8_next(str+i, len-i, &ch);
+		w += glyph_advance(g, ch);
+		if (w > width) return cut;
+		i += n;
+		if (w <= room) cut = i;
+	}
+	return len;
+}
+
 void textbox_font(textbox *tb, char *font, char *fg, char *bg);
 void textbox_text(textbox *tb, char *text);
 void textbox_moveresize(textbox *tb, int x, int y, int w, int h);
@@ -81,30 +194,60 @@ textbox* textbox_create(Window parent, unsigned long flags, short x, short y, sh
 	return tb;
 }
 
-// set an Xft font by name
+// set an Xft font and colors by name. called on every bar state change,
+// so only touch what actually changed and give back the old colors
 void textbox_font(textbox *tb, char *font, char *fg, char *bg)
 {
-	if (tb->font) XftFontClose(display, tb->font);
-	tb->font = XftFontOpenName(display, DefaultScreen(display), font);
+	Visual *visual = DefaultVisual(display, DefaultScreen(display));
+	Colormap map = DefaultColormap(display, DefaultScreen(display));
+
+	// the usual case, from every bar update
+	if (tb->font_name && !strcmp(tb->font_name, font) && tb->fg_name && !strcmp(tb->fg_name, fg)
+		&& tb->bg_name && !strcmp(tb->bg_name, bg))
+		return;
 
-	XftColorAllocName(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), fg, &tb->color_fg);
-	XftColorAllocName(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), bg, &tb->color_bg);
+	pthread_mutex_lock(&xft_mutex);
+	if (!tb->font_name || strcmp(tb->font_name, font))
+	{
+		if (tb->font) XftFontClose(display, tb->font);
+		tb->font = XftFontOpenName(display, DefaultScreen(display), font);
+		free(tb->font_name); tb->font_name = strdup(font);
+	}
+	if (!tb->fg_name || strcmp(tb->fg_name, fg))
+	{
+		if (tb->fg_name) XftColorFree(display, visual, map, &tb->color_fg);
+		XftColorAllocName(display, visual, map, fg, &tb->color_fg);
+		free(tb->fg_name); tb->fg_name = strdup(fg);
+	}
+	if (!tb->bg_name || strcmp(tb->bg_name, bg))
+	{
+		if (tb->bg_name) XftColorFree(display, visual, map, &tb->color_bg);
+		XftColorAllocName(display, visual, map, bg, &tb->color_bg);
+		free(tb->bg_name); tb->bg_name = strdup(bg);
+	}
+	pthread_mutex_unlock(&xft_mutex);
 }
 
 // outer code may need line height, width, etc
 void textbox_extents(textbox *tb)
 {
-	int length = strlen(tb->text) + strlen(tb->prompt);
-	char line[length + 1];
-	sprintf(line, "%s%s", tb->prompt, tb->text);
-	XftTextExtents8(display, tb->font, (unsigned char*)line, length, &tb->extents);
+	memset(&tb->extents, 0, sizeof(XGlyphInfo));
+	tb->extents.width  = textbox_measure(tb->font, tb->prompt, strlen(tb->prompt))
+		+ textbox_measure(tb->font, tb->text, strlen(tb->text));
+	tb->extents.height = tb->font->ascent + tb->font->descent;
+	tb->extents.xOff   = tb->extents.width;
 }
 
-// set the default text to display
+// set the default text to display. the buffer is kept and only ever grows
 void textbox_text(textbox *tb, char *text)
 {
-	if (tb->text) free(tb->text);
-	tb->text = strdup(text ? text: "");
+	int len = strlen(text ? text: "");
+	if (len+1 > tb->size)
+	{
+		tb->size = len+1;
+		tb->text = realloc(tb->text, tb->size);
+	}
+	memmove(tb->text, text ? text: "", len+1);
 	tb->cursor = MAX(0, MIN(strlen(tb->text), tb->cursor));
 	textbox_extents(tb);
 }
@@ -154,77 +297,201 @@ void textbox_free(textbox *tb)
 
 	if (tb->text) free(tb->text);
 	if (tb->prompt) free(tb->prompt);
+	pthread_mutex_lock(&xft_mutex);
 	if (tb->font) XftFontClose(display, tb->font);
+	if (tb->fg_name) XftColorFree(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &tb->color_fg);
+	if (tb->bg_name) XftColorFree(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &tb->color_bg);
+	pthread_mutex_unlock(&xft_mutex);
+	free(tb->font_name); free(tb->fg_name); free(tb->bg_name);
 
 	XDestroyWindow(display, tb->window);
 	free(tb);
 }
 
-void textbox_draw(textbox *tb)
+// Finished text boxes kept as server-side pixmaps, least recently used
+// out first. Title bars flip between a few strings and two color schemes,
+// so most redraws become a single copy with no glyph rendering or Xft at
+// all. The table has its own mutex. The main and render thread connections
+// share the slots but each only ever frees its own pixmaps, under its own
+// PIXMAP_BYTES cap, as Xlib is not initialized for threads.
+
+#define PIXMAPS 64
+#define PIXMAP_BYTES (4*1024*1024)
+#define PIXMAP_KEY 1024
+
+typedef struct {
+	Display *display;
+	Pixmap pixmap;
+	char *key;
+	unsigned long hash, used;
+	unsigned long flags;
+	short w, h;
+} pixmap_entry;
+
+pixmap_entry pixmaps[PIXMAPS];
+unsigned long pixmap_tick;
+pthread_mutex_t pixmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct {
+	unsigned long hits, misses, evictions;
+	size_t bytes;
+} pixmap_stats;
+
+// everything that decides the pixels, into a PIXMAP_KEY buffer. 0 when not
+// worth keeping
+int pixmap_key(textbox *tb, char *key, unsigned long *hash)
 {
-	int i;
-	XGlyphInfo extents;
+	char *s;
+	if (tb->flags & TB_EDITABLE || !tb->font_name || !tb->fg_name || !tb->bg_name)
+		return 0;
+	if (snprintf(key, PIXMAP_KEY, "%s\n%s\n%s\n%s", tb->font_name, tb->fg_name, tb->bg_name, tb->text ? tb->text: "") >= PIXMAP_KEY)
+		return 0;
+	for (*hash = 5381, s = key; *s; s++) *hash = *hash * 33 + *s;
+	return 1;
+}
 
+// caller holds pixmap_mutex. only the same connection can evict the entry,
+// so its pixmap stays valid after the mutex is dropped
+Pixmap pixmap_find(Display *display, textbox *tb, char *key, unsigned long hash)
+{
+	for (int i = 0; i < PIXMAPS; i++)
+	{
+		pixmap_entry *p = &pixmaps[i];
+		if (p->key && p->display == display && p->hash == hash && p->w == tb->w && p->h == tb->h
+			&& p->flags == tb->flags && !strcmp(p->key, key))
+		{
+			p->used = ++pixmap_tick;
+			pixmap_stats.hits++;
+			return p->pixmap;
+		}
+	}
+	pixmap_stats.misses++;
+	return None;
+}
+
+void pixmap_evict(pixmap_entry *p)
+{
+	XFreePixmap(p->display, p->pixmap);
+	pixmap_stats.bytes -= (size_t)p->w * p->h * 4;
+	pixmap_stats.evictions++;
+	free(p->key);
+	memset(p, 0, sizeof(pixmap_entry));
+}
+
+// keep the canvas, making room under this connection's cap by evicting its
+// own entries. caller holds pixmap_mutex
+int pixmap_store(Display *display, textbox *tb, Pixmap canvas, char *key, unsigned long hash)
+{
+	size_t size = (size_t)tb->w * tb->h * 4, own; int i; pixmap_entry *p, *old;
+	if (size > PIXMAP_BYTES / 4)
+		return 0;
+	for (;;)
+	{
+		for (i = 0, own = 0, p = NULL, old = NULL; i < PIXMAPS; i++)
+		{
+			if (!pixmaps[i].key) p = &pixmaps[i];
+			else
+			if (pixmaps[i].display == display)
+			{
+				own += (size_t)pixmaps[i].w * pixmaps[i].h * 4;
+				if (!old || pixmaps[i].used < old->used) old = &pixmaps[i];
+			}
+		}
+		if (p && own + size <= PIXMAP_BYTES) break;
+		// every slot held by the other connection
+		if (!old)
+			return 0;
+		pixmap_evict(old);
+	}
+	p->display = display; p->pixmap = canvas;
+	p->key = strdup(key); p->hash = hash;
+	p->flags = tb->flags; p->w = tb->w; p->h = tb->h;
+	p->used = ++pixmap_tick;
+	pixmap_stats.bytes += size;
+	return 1;
+}
+
+// draw over any display connection. the caller has already measured the
+// text offset, prompt width and cursor position; plain left aligned text
+// needs no measuring, so the render thread never touches the glyph caches.
+// xft_mutex is held only while Xft draws, and not at all for a cached bar
+void textbox_paint(Display *display, textbox *tb, int x, int prompt_width, int cursor_x)
+{
 	GC context    = XCreateGC(display, tb->window, 0, 0);
+	unsigned long hash = 0; Pixmap hit = None; char key[PIXMAP_KEY]; int stored = 0;
+	int keyed = pixmap_key(tb, key, &hash);
+
+	if (keyed)
+	{
+		pthread_mutex_lock(&pixmap_mutex);
+		hit = pixmap_find(display, tb, key, hash);
+		pthread_mutex_unlock(&pixmap_mutex);
+	}
+	if (hit)
+	{
+		XCopyArea(display, hit, tb->window, context, 0, 0, tb->w, tb->h, 0, 0);
+		XFreeGC(display, context);
+		return;
+	}
 	Pixmap canvas = XCreatePixmap(display, tb->window, tb->w, tb->h, DefaultDepth(display, DefaultScreen(display)));
+	pthread_mutex_lock(&xft_mutex);
 	XftDraw *draw = XftDrawCreate(display, canvas, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)));
 
 	// clear canvas
 	XftDrawRect(draw, &tb->color_bg, 0, 0, tb->w, tb->h);
 
-	char *line   = tb->text,
-		*text   = tb->text ? tb->text: "",
+	char *text   = tb->text ? tb->text: "",
 		*prompt = tb->prompt ? tb->prompt: "";
 
 	int text_len    = strlen(text);
-	int length      = text_len;
+	int prompt_len  = tb->flags & TB_EDITABLE ? strlen(prompt): 0;
 	int line_height = tb->font->ascent + tb->font->descent;
+	int y = tb->font->ascent;
 
-	int cursor_x      = 0;
-	int cursor_offset = 0;
-	int cursor_width  = MAX(2, line_height/10);
+	// draw the text, including any prompt in edit mode
+	XftDrawStringUtf8(draw, &tb->color_fg, tb->font, x, y, (FcChar8*)prompt, prompt_len);
+	XftDrawStringUtf8(draw, &tb->color_fg, tb->font, x + prompt_width, y, (FcChar8*)text, text_len);
 
+	// draw the cursor
 	if (tb->flags & TB_EDITABLE)
 	{
-		int prompt_len = strlen(prompt);
-		length = text_len + prompt_len;
-		cursor_offset = MIN(tb->cursor + prompt_len, length);
+		int cursor_width = MAX(2, line_height/10);
+		XftDrawRect(draw, &tb->color_fg, cursor_x, 2, cursor_width, line_height-4);
+	}
+	XftDrawDestroy(draw);
+	pthread_mutex_unlock(&xft_mutex);
 
-		char eline[length + 10]; line = eline;
-		sprintf(line, "%s%s", prompt, text);
+	// flip canvas to window
+	XCopyArea(display, canvas, tb->window, context, 0, 0, tb->w, tb->h, 0, 0);
+	XFreeGC(display, context);
 
-		// replace spaces so XftTextExtents8 includes their width
-		for (i = 0; i < length; i++) if (isspace(line[i])) line[i] = '_';
+	if (keyed)
+	{
+		pthread_mutex_lock(&pixmap_mutex);
+		stored = pixmap_store(display, tb, canvas, key, hash);
+		pthread_mutex_unlock(&pixmap_mutex);
+	}
+	if (!stored) XFreePixmap(display, canvas);
+}
 
-		// calc cursor position
-		XftTextExtents8(display, tb->font, (unsigned char*)line, cursor_offset, &extents);
-		cursor_x = extents.width;
+void textbox_draw(textbox *tb)
+{
+	char *text   = tb->text ? tb->text: "",
+		*prompt = tb->prompt ? tb->prompt: "";
 
-		// restore correct text string with spaces
-		sprintf(line, "%s%s", prompt, text);
-	}
+	int text_len   = strlen(text);
+	int prompt_len = tb->flags & TB_EDITABLE ? strlen(prompt): 0;
 
-	// calc full input text width
-	XftTextExtents8(display, tb->font, (unsigned char*)line, length, &extents);
-	int line_width = extents.width;
+	int prompt_width = prompt_len ? textbox_measure(tb->font, prompt, prompt_len): 0;
+	int line_width   = tb->flags & (TB_RIGHT|TB_CENTER) ? prompt_width + textbox_measure(tb->font, text, text_len): 0;
 
-	int x = 0, y = tb->font->ascent;
+	int x = 0;
 	if (tb->flags & TB_RIGHT)  x = tb->w - line_width;
 	if (tb->flags & TB_CENTER) x = MAX(0, (tb->w - line_width) / 2);
 
-	// draw the text, including any prompt in edit mode
-	XftDrawString8(draw, &tb->color_fg, tb->font, x, y, (unsigned char*)line, length);
-
-	// draw the cursor
-	if (tb->flags & TB_EDITABLE)
-		XftDrawRect(draw, &tb->color_fg, cursor_x, 2, cursor_width, line_height-4);
-
-	// flip canvas to window
-	XCopyArea(display, canvas, tb->window, context, 0, 0, tb->w, tb->h, 0, 0);
+	int cursor_x = tb->flags & TB_EDITABLE ? x + prompt_width + textbox_measure(tb->font, text, MIN(tb->cursor, text_len)): 0;
 
-	XFreeGC(display, context);
-	XftDrawDestroy(draw);
-	XFreePixmap(display, canvas);
+	textbox_paint(display, tb, x, prompt_width, cursor_x);
 }
 
 // cursor handling for edit mode
@@ -233,16 +500,23 @@ void textbox_cursor(textbox *tb, int pos)
 	tb->cursor = MAX(0, MIN(strlen(tb->text), pos));
 }
 
-// move right
+// UTF-8 continuation byte
+#define UTF8_CONT(c) (((c) & 0xc0) == 0x80)
+
+// move right one character
 void textbox_cursor_inc(textbox *tb)
 {
-	textbox_cursor(tb, tb->cursor+1);
+	int pos = tb->cursor+1;
+	while (tb->text[pos-1] && UTF8_CONT(tb->text[pos])) pos++;
+	textbox_cursor(tb, pos);
 }
 
-// move left
+// move left one character
 void textbox_cursor_dec(textbox *tb)
 {
-	textbox_cursor(tb, tb->cursor-1);
+	int pos = tb->cursor-1;
+	while (pos > 0 && UTF8_CONT(tb->text[pos])) pos--;
+	textbox_cursor(tb, pos);
 }
 
 // beginning of line
@@ -263,7 +537,11 @@ void textbox_insert(textbox *tb, int pos, char *str)
 	int len = strlen(tb->text), slen = strlen(str);
 	pos = MAX(0, MIN(len, pos));
 	// expand buffer
-	tb->text = realloc(tb->text, len + slen + 1);
+	if (len + slen + 1 > tb->size)
+	{
+		tb->size = len + slen + 1;
+		tb->text = realloc(tb->text, tb->size);
+	}
 	// move everything after cursor upward
 	char *at = tb->text + pos;
 	memmove(at + slen, at, len - pos + 1);
@@ -277,9 +555,10 @@ void textbox_delete(textbox *tb, int pos, int dlen)
 {
 	int len = strlen(tb->text);
 	pos = MAX(0, MIN(len, pos));
+	dlen = MAX(0, MIN(len - pos, dlen));
 	// move everything after pos+dlen down
 	char *at = tb->text + pos;
-	memmove(at, at + dlen, len - pos);
+	memmove(at, at + dlen, len - pos - dlen + 1);
 	textbox_extents(tb);
 }
 
@@ -291,10 +570,13 @@ void textbox_cursor_ins(textbox *tb, char c)
 	textbox_cursor_inc(tb);
 }
 
-// delete on character
+// delete one character
 void textbox_cursor_del(textbox *tb)
 {
-	textbox_delete(tb, tb->cursor, 1);
+	int len = 1;
+	if (!tb->text[tb->cursor]) return;
+	while (UTF8_CONT(tb->text[tb->cursor+len])) len++;
+	textbox_delete(tb, tb->cursor, len);
 }
 
 // back up and delete one character
@@ -333,7 +615,7 @@ int textbox_keypress(textbox *tb, XEvent *ev)
 			if (!iscntrl(*pad))
 			{
 				textbox_insert(tb, tb->cursor, pad);
-				textbox_cursor_inc(tb);
+				textbox_cursor(tb, tb->cursor + len);
 				return 1;
 			}
 	}
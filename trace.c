@@ -0,0 +1,85 @@
+/*
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// Opt-in Chrome trace-event output. Set XOAT_TRACE to a file name and load
+// the result in chrome://tracing or ui.perfetto.dev. Spans are complete
+// ("X") events closed by a cleanup handler, so early returns still end
+// them; synchronous requests show up as instant events inside the span
+// that made them.
+
+FILE *trace_file;
+int trace_pid;
+
+typedef struct {
+	const char *cat, *name;
+	long long start;
+} trace_span;
+
+void trace_end(trace_span *s)
+{
+	if (!trace_file || s->start < 0) return;
+	fprintf(trace_file, "{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d},\n",
+		s->cat, s->name ? s->name: "?", s->start, usec() - s->start, trace_pid, trace_pid);
+}
+
+void trace_instant(const char *name)
+{
+	fprintf(trace_file, "{\"cat\":\"x11\",\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":%d,\"tid\":%d},\n",
+		name, usec(), trace_pid, trace_pid);
+}
+
+#define TRACE(cat, name) trace_span __attribute__((cleanup(trace_end))) trace_span_ = { (cat), (name), trace_file ? usec(): -1 }
+#define TRACE_SYNC(name) (trace_file ? trace_instant(name): (void)0)
+
+// trailing commas are fine; viewers also accept a missing ']'
+void trace_close()
+{
+	if (!trace_file) return;
+	fprintf(trace_file, "{}]\n");
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+// called before the loop sleeps, so a hang still leaves a readable trace
+void trace_flush()
+{
+	if (trace_file) fflush(trace_file);
+}
+
+void trace_open()
+{
+	char *path = getenv("XOAT_TRACE");
+	if (!path || !*path) return;
+	if (!(trace_file = fopen(path, "w")))
+	{
+		warn("trace %s", path);
+		return;
+	}
+	fcntl(fileno(trace_file), F_SETFD, FD_CLOEXEC);
+	trace_pid = getpid();
+	fprintf(trace_file, "[\n");
+	atexit(trace_close);
+}
@@ -28,6 +28,7 @@ int window_get_prop(Window w, Atom prop, Atom *type, int *items, void *buffer, i
 {
 	memset(buffer, 0, bytes);
 	int format; unsigned long nitems, nbytes; unsigned char *ret = NULL;
+	TRACE_SYNC("XGetWindowProperty");
 	if (XGetWindowProperty(display, w, prop, 0, bytes/4, False, AnyPropertyType, type,
 		&format, &nitems, &nbytes, &ret) == Success && ret && *type != None && format)
 	{
@@ -40,24 +41,21 @@ int window_get_prop(Window w, Atom prop, Atom *type, int *items, void *buffer, i
 	return 0;
 }
 
-// retrieve a text property from a window
+// retrieve a text property from a window, in the per-event arena
 // technically we could use window_get_prop(), but this is better for character set support
 char* window_get_text_prop(Window w, Atom atom)
 {
 	XTextProperty prop; char *res = NULL;
 	char **list = NULL; int count;
+	TRACE_SYNC("XGetTextProperty");
 	if (XGetTextProperty(display, w, &prop, atom) && prop.value && prop.nitems)
 	{
 		if (prop.encoding == XA_STRING)
-		{
-			res = malloc(strlen((char*)prop.value)+1);
-			strcpy(res, (char*)prop.value);
-		}
+			res = strcpy(arena_alloc(strlen((char*)prop.value)+1), (char*)prop.value);
 		else
 		if (XmbTextPropertyToTextList(display, &prop, &list, &count) >= Success && count > 0 && *list)
 		{
-			res = malloc(strlen(*list)+1);
-			strcpy(res, *list);
+			res = strcpy(arena_alloc(strlen(*list)+1), *list);
 			XFreeStringList(list);
 		}
 	}
@@ -85,21 +83,31 @@ int window_send_clientmessage(Window target, Window subject, Atom atom, unsigned
 	e.xclient.data.l[1]    = latest;
 	e.xclient.send_event   = True;
 	e.xclient.format       = 32;
-	int r = XSendEvent(display, target, False, mask, &e) ?1:0;
-	XFlush(display);
-	return r;
+	return XSendEvent(display, target, False, mask, &e) ?1:0;
+}
+
+// click-to-focus. an unfocused window holds a sync grab, so its first
+// click comes to us and is then replayed to it
+void window_grab_buttons(Window win)
+{
+	XGrabButton(display, Button1, AnyModifier, win, False, ButtonPressMask, GrabModeSync, GrabModeSync, None, None);
+	XGrabButton(display, Button3, AnyModifier, win, False, ButtonPressMask, GrabModeSync, GrabModeSync, None, None);
 }
 
 void window_listen(Window win)
 {
-	XSelectInput(display, win, EnterWindowMask | LeaveWindowMask | FocusChangeMask | PropertyChangeMask);
+	// only what a handler consumes. pointer crossings are not
+	XSelectInput(display, win, FocusChangeMask | PropertyChangeMask);
+	window_grab_buttons(win);
 }
 
 // build windows cache
 void query_windows()
 {
 	unsigned int nwins; int i; Window w1, w2, *wins; client *c;
-	if (windows.depth || !(XQueryTree(display, root, &w1, &w2, &wins, &nwins) && wins))
+	if (windows.depth) return;
+	TRACE_SYNC("XQueryTree");
+	if (!(XQueryTree(display, root, &w1, &w2, &wins, &nwins) && wins))
 		return;
 	for (i = nwins-1; i > -1 && windows.depth < STACK; i--)
 	{
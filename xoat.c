@@ -45,6 +45,21 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stddef.h>
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -68,6 +83,7 @@ typedef struct {
 	short x, y, w, h;
 	box spots[SPOT3+1];
 	textbox *bars[SPOT3+1];
+	short bar_state[SPOT3+1];
 } monitor;
 
 typedef struct {
@@ -75,9 +91,10 @@ typedef struct {
 	XWindowAttributes attr;
 	Window transient, leader;
 	Atom type, states[ATOMLIST+1];
-	short monitor, visible, manage, input, urgent, full, ours, maxv, maxh;
+	short monitor, visible, manage, input, urgent, full, ours, maxv, maxh, prefetched;
 	unsigned long spot;
-	char *class;
+	char *class, *role;
+	XSizeHints *size;
 } client;
 
 typedef struct {
@@ -96,6 +113,11 @@ typedef struct {
 
 client* window_build_client(Window);
 void client_free(client*);
+void spot_update_bar(int, int);
+void ewmh_client_list();
+void timer_cancel(int);
+void settings_reload();
+void unmanaged_remove(Window);
 void action_move(void*, int, client*);
 void action_focus(void*, int, client*);
 void action_move_direction(void*, int, client*);
@@ -107,6 +129,9 @@ void action_command(void*, int, client*);
 void action_find_or_start(void*, int, client*);
 void action_move_monitor(void*, int, client*);
 void action_focus_monitor(void*, int, client*);
+void action_focus_previous(void*, int, client*);
+void action_switcher(void*, int, client*);
+void action_run(void*, int, client*);
 void action_fullscreen(void*, int, client*);
 void action_maximize_vert(void*, int, client*);
 void action_maximize_horz(void*, int, client*);
@@ -117,7 +142,7 @@ void action_maximize_horz(void*, int, client*);
 #define OVERLAP(a,b,c,d) (((a)==(c) && (b)==(d)) || MIN((a)+(b), (c)+(d)) - MAX((a), (c)) > 0)
 #define INTERSECT(x,y,w,h,x1,y1,w1,h1) (OVERLAP((x),(w),(x1),(w1)) && OVERLAP((y),(h),(y1),(h1)))
 
-#define STACK_INIT(n) stack (n); memset(&(n), 0, sizeof(stack))
+#define STACK_INIT(n) stack (n); (n).depth = 0
 #define STACK_FREE(s) while ((s)->depth) client_free((s)->clients[--(s)->depth])
 
 #define for_windows(i,c)\
@@ -144,27 +169,44 @@ monitor monitors[MONITORS];
 int nmonitors = 1;
 short current_spot, current_mon;
 Window root, ewmh, current = None;
+unsigned long pixel_focus, pixel_blur, pixel_urgent;
 stack windows;
-static int (*xerror)(Display *, XErrorEvent *);
 
-void catch_exit(int sig)
-{
-	while (0 < waitpid(-1, NULL, WNOHANG));
-}
+// config.h values that the config file may change at runtime
+typedef struct {
+	int border, gap, spot1_width_pct, spot2_height_pct;
+	char title[256], title_blur[64], title_focus[64];
+	char border_blur[64], border_focus[64], border_urgent[64];
+} config;
+
+config settings;
+static int (*xerror)(Display *, XErrorEvent *);
 
-void exec_cmd(char *cmd)
+long long usec()
 {
-	signal(SIGCHLD, catch_exit);
-	if (!cmd || !cmd[0] || fork()) return;
-	setsid();
-	EXECSH(cmd);
-	exit(EXIT_FAILURE);
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
+#include "arena.c"
+#include "trace.c"
 #include "window.c"
+#include "cache.c"
+#include "defer.c"
 #include "ewmh.c"
 #include "client.c"
+#include "prefetch.c"
+#include "place.c"
+#include "admit.c"
+#include "render.c"
 #include "spot.c"
+#include "launch.c"
+#include "loop.c"
+#include "stats.c"
+#include "menu.c"
+#include "path.c"
+#include "settings.c"
 #include "event.c"
 #include "action.c"
 #include "setup.c"
@@ -176,6 +218,7 @@ void (*handlers[LASTEvent])(XEvent*) = {
 	[MapRequest]       = map_request,
 	[MapNotify]        = map_notify,
 	[UnmapNotify]      = unmap_notify,
+	[DestroyNotify]    = destroy_notify,
 	[KeyPress]         = key_press,
 	[ButtonPress]      = button_press,
 	[ClientMessage]    = client_message,
@@ -185,6 +228,17 @@ void (*handlers[LASTEvent])(XEvent*) = {
 	[FocusOut]         = any_event,
 };
 
+// return 0 to drop an event before any client is built
+int (*filters[LASTEvent])(XEvent*) = {
+	[FocusIn]          = focus_filter,
+	[FocusOut]         = focus_filter,
+	[CreateNotify]     = create_filter,
+	[ConfigureNotify]  = configure_filter,
+	[MapNotify]        = map_filter,
+	[UnmapNotify]      = unmap_filter,
+	[DestroyNotify]    = destroy_filter,
+};
+
 int oops(Display *d, XErrorEvent *ee)
 {
 	if (ee->error_code == BadWindow
@@ -193,13 +247,21 @@ int oops(Display *d, XErrorEvent *ee)
 		|| (ee->request_code == X_GrabButton      && ee->error_code == BadAccess)
 		|| (ee->request_code == X_GrabKey         && ee->error_code == BadAccess)
 		) return 0;
+	// the render connection only draws bars, which may be gone by the time
+	// a queued job reaches them. nothing it does is worth exiting over
+	if (d == render_display)
+	{
+		if (ee->error_code != BadDrawable && ee->error_code != BadPixmap && ee->error_code != BadMatch)
+			fprintf(stderr, "render error: request code=%d, error code=%d\n", ee->request_code, ee->error_code);
+		return 0;
+	}
 	fprintf(stderr, "error: request code=%d, error code=%d\n", ee->request_code, ee->error_code);
-	return xerror(display, ee);
+	return xerror(d, ee);
 }
 
 int main(int argc, char *argv[])
 {
-	int i; XEvent ev; Atom msg = None;
+	XEvent ev; Atom msg = None;
 
 	if (!(display = XOpenDisplay(0))) return 1;
 
@@ -207,7 +269,9 @@ int main(int argc, char *argv[])
 	root   = DefaultRootWindow(display);
 	xerror = XSetErrorHandler(oops);
 
-	for (i = 0; i < ATOMS; i++) atoms[i] = XInternAtom(display, atom_names[i], False);
+	startup_phase(NULL);
+	XInternAtoms(display, (char**)atom_names, ATOMS, False, atoms);
+	startup_phase("atoms");
 
 	// check for restart/exit
 	if (argc > 1)
@@ -215,8 +279,10 @@ int main(int argc, char *argv[])
 		Window cli = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0, None, None);
 		     if (!strcmp(argv[1], "restart")) msg = atoms[XOAT_RESTART];
 		else if (!strcmp(argv[1], "exit"))    msg = atoms[XOAT_EXIT];
+		else if (!strcmp(argv[1], "stats"))   { stats_request(cli); exit(EXIT_SUCCESS); }
 		else errx(EXIT_FAILURE, "huh? %s", argv[1]);
 		window_send_clientmessage(root, cli, msg, 0, SubstructureNotifyMask | SubstructureRedirectMask);
+		XSync(display, False);
 		exit(EXIT_SUCCESS);
 	}
 
@@ -226,9 +292,34 @@ int main(int argc, char *argv[])
 	for (;;)
 	{
 		STACK_FREE(&windows);
+		arena_reset();
+		// only input events carry a time worth focusing with; map, unmap,
+		// destroy, timers and deferred work use CurrentTime
+		latest = CurrentTime;
+		// XPending flushes; only sleep once the queue is drained and
+		// deferred work is done
+		int queued = XPending(display);
+		if (!queued)
+		{
+			if (defer_flush()) continue;
+			trace_flush();
+			loop_wait();
+			continue;
+		}
+		if (queued > event_backlog)
+			event_backlog = queued;
 		XNextEvent(display, &ev);
+		// extension events (XKB, RandR) are numbered past the core tables
+		if (ev.type < 0 || ev.type >= LASTEvent) continue;
+		event_stats[ev.type].seen++;
+		if (filters[ev.type] && !filters[ev.type](&ev))
+			{ event_stats[ev.type].dropped++; continue; }
 		if (handlers[ev.type])
+		{
+			TRACE("event", event_names[ev.type]);
+			event_stats[ev.type].handled++;
 			handlers[ev.type](&ev);
+		}
 	}
 	return EXIT_SUCCESS;
 }